@@ -0,0 +1,205 @@
+#ifndef __OICOMPARE_ALTERNATIVES_HH__
+#define __OICOMPARE_ALTERNATIVES_HH__
+
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "oicompare.hh"
+
+namespace oicompare
+{
+/**
+ * Result of compare_alternatives().
+ */
+struct alternatives_result
+{
+  /**
+   * Index of the alternative which matched, or of the one whose mismatch is
+   * reported.
+   */
+  std::size_t alternative;
+
+  /**
+   * The mismatch with the alternative, or none if it matched.
+   */
+  std::optional<oicompare::mismatch<const char *, const char *>> mismatch;
+};
+
+namespace detail
+{
+template <typename Policy>
+alternatives_result
+compare_alternatives (std::span<const std::string_view> expected,
+                      std::string_view received, const tolerance *tolerance)
+{
+  if (expected.empty ())
+    throw std::invalid_argument{"There must be an expected output"};
+
+  struct cursor
+  {
+    block_scanner<Policy> scanner;
+    std::size_t line_number = 1;
+    bool line_start = true;
+    // The end of the expected output, held while the received one has more
+    // newlines before its end.
+    std::optional<token<const char *>> held = std::nullopt;
+  };
+
+  std::vector<cursor> cursors;
+  cursors.reserve (expected.size ());
+  std::vector<std::size_t> live;
+  for (const auto &alternative : expected)
+    {
+      live.push_back (cursors.size ());
+      cursors.push_back ({{alternative.data (),
+                           alternative.data () + alternative.size ()}});
+    }
+  std::vector<std::optional<oicompare::mismatch<const char *, const char *>>>
+      mismatches (expected.size ());
+
+  // The received output is tokenized once, and every token of it is compared
+  // with the next one of each alternative which still matches.
+  block_scanner<Policy> scanner2{received.data (),
+                                 received.data () + received.size ()};
+  [[maybe_unused]] bool line_start2 = true;
+  while (true)
+    {
+      auto tok2 = scanner2.next ();
+      if constexpr (Policy::ignore_blank_lines)
+        {
+          while (line_start2 && tok2.type == token_type::newline)
+            tok2 = scanner2.next ();
+          line_start2 = tok2.type == token_type::newline;
+        }
+
+      std::size_t kept = 0;
+      for (auto index : live)
+        {
+          auto &cursor = cursors[index];
+          auto tok1 = cursor.held ? *std::exchange (cursor.held, std::nullopt)
+                                  : cursor.scanner.next ();
+
+          if constexpr (Policy::ignore_blank_lines)
+            {
+              for (; cursor.line_start && tok1.type == token_type::newline;
+                   tok1 = cursor.scanner.next ())
+                ++cursor.line_number;
+              cursor.line_start = tok1.type == token_type::newline;
+            }
+
+          if constexpr (!Policy::strict_trailing_whitespace)
+            {
+              if (tok1.type == token_type::eof
+                  && tok2.type == token_type::newline)
+                {
+                  cursor.held = tok1;
+                  live[kept++] = index;
+                  continue;
+                }
+              else if (tok2.type == token_type::eof)
+                while (tok1.type == token_type::newline)
+                  tok1 = cursor.scanner.next ();
+            }
+
+          if (auto mismatch = tok1.template compare<Policy> (tok2))
+            {
+              std::optional<double> difference;
+              if (tolerance)
+                {
+                  bool accepted;
+                  std::tie (accepted, difference)
+                      = compare_numbers (*tolerance, tok1, tok2);
+                  if (accepted)
+                    {
+                      live[kept++] = index;
+                      continue;
+                    }
+                }
+
+              mismatches[index]
+                  = oicompare::mismatch<const char *, const char *>{
+                      cursor.line_number, std::move (*mismatch), tok1, tok2,
+                      difference};
+              continue;
+            }
+          else if (tok1.type == token_type::newline)
+            ++cursor.line_number;
+
+          live[kept++] = index;
+        }
+      live.resize (kept);
+
+      // Every alternative left ends with the received output.
+      if (!live.empty () && tok2.type == token_type::eof)
+        return {live.front (), std::nullopt};
+      else if (live.empty ())
+        break;
+    }
+
+  // The alternative which matched the longest part of the received output
+  // tells the most about it.
+  std::size_t alternative = 0;
+  for (std::size_t index = 1; index < mismatches.size (); ++index)
+    if (mismatches[index]->second.first
+        > mismatches[alternative]->second.first)
+      alternative = index;
+
+  auto &result = mismatches[alternative];
+  if constexpr (newline_is_whitespace<Policy>)
+    result->line_number
+        += count_newlines (expected[alternative].data (), result->first.first);
+  return {alternative, std::move (result)};
+}
+}
+
+/**
+ * Compares a received output with alternatives of the expected output, any
+ * of which is accepted, as if each of them were compared with it by
+ * compare(), but tokenizing the received output only once.
+ *
+ * The alternatives are compared together, token by token, and each of them
+ * is dropped at its mismatch. The result is the first alternative which
+ * matches, if any does. Otherwise, it is the alternative which matched the
+ * longest part of the received output (the first one of those), with its
+ * mismatch.
+ *
+ * @param expected alternatives of the expected output, at least one
+ * @param received received output
+ * @return alternative and its mismatch, if none matched
+ */
+template <typename Policy = default_policy>
+alternatives_result
+compare_alternatives (std::span<const std::string_view> expected,
+                      std::string_view received)
+{
+  return detail::compare_alternatives<Policy> (expected, received, nullptr);
+}
+
+/**
+ * Compares a received output with alternatives of the expected output,
+ * comparing words which are numbers with a tolerance.
+ *
+ * @see compare_alternatives
+ *
+ * @param expected alternatives of the expected output, at least one
+ * @param received received output
+ * @param tolerance tolerance of numbers
+ * @return alternative and its mismatch, if none matched
+ */
+template <typename Policy = default_policy>
+alternatives_result
+compare_alternatives (std::span<const std::string_view> expected,
+                      std::string_view received, const tolerance &tolerance)
+{
+  return detail::compare_alternatives<Policy> (expected, received,
+                                               &tolerance);
+}
+}
+
+#endif /* __OICOMPARE_ALTERNATIVES_HH__ */
\ No newline at end of file
@@ -0,0 +1,155 @@
+#ifndef __OICOMPARE_BATCH_HH__
+#define __OICOMPARE_BATCH_HH__
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "io.hh"
+#include "thread_pool.hh"
+#include "translations.hh"
+
+namespace oicompare::io
+{
+/**
+ * Compares the pairs of files listed in a manifest, one pair per line in the
+ * form "EXPECTED RECEIVED [TRANSLATION]", formatting a line with the exit code
+ * and the message for each pair in the order of the manifest.
+ *
+ * The pairs are compared on a thread pool, largest first. A pair which cannot
+ * be compared gets the exit code 2 and the description of the error.
+ *
+ * @param manifest_path path to the manifest
+ * @param buffer output buffer
+ * @param options how to compare the files, other than with mismatches
+ * @param threads number of threads comparing the pairs
+ * @return the largest exit code of the pairs
+ * @throws std::runtime_error if a line of the manifest is invalid
+ */
+inline int
+compare_batch (const char *manifest_path, fmt::memory_buffer &buffer,
+               const options &options = {},
+               std::size_t threads = std::thread::hardware_concurrency ())
+{
+  using namespace std::string_view_literals;
+
+  struct entry
+  {
+    std::string expected;
+    std::string received;
+    translations::formatter format;
+    std::uintmax_t size = 0;
+    int status = 2;
+    std::string message;
+  };
+
+  std::vector<entry> entries;
+
+  {
+    mapped_file manifest{manifest_path};
+    auto contents = manifest.contents ();
+    std::size_t line_number = 0;
+
+    while (!contents.empty ())
+      {
+        auto line = contents.substr (0, contents.find ('\n'));
+        contents.remove_prefix (std::min (line.size () + 1, contents.size ()));
+        ++line_number;
+
+        std::vector<std::string_view> fields;
+        while (true)
+          {
+            line.remove_prefix (
+                std::min (line.find_first_not_of (" \t\r"sv), line.size ()));
+            if (line.empty ())
+              break;
+            fields.push_back (line.substr (0, line.find_first_of (" \t\r"sv)));
+            line.remove_prefix (fields.back ().size ());
+          }
+
+        if (fields.empty ())
+          continue;
+        else if (fields.size () > 3 || fields.size () < 2)
+          throw std::runtime_error{
+              fmt::format ("{}:{}: Expected EXPECTED RECEIVED [TRANSLATION]",
+                           manifest_path, line_number)};
+
+        auto translation_name
+            = fields.size () < 3 ? "english_terse"sv : fields[2];
+        auto format = translations::parse (translation_name);
+        if (!format)
+          throw std::runtime_error{
+              fmt::format ("{}:{}: Unknown translation: {}", manifest_path,
+                           line_number, translation_name)};
+
+        auto &entry = entries.emplace_back ();
+        entry.expected = fields[0];
+        entry.received = fields[1];
+        entry.format = format;
+      }
+  }
+
+  for (auto &entry : entries)
+    {
+      std::error_code error;
+      for (const auto &path : {entry.expected, entry.received})
+        if (auto size = std::filesystem::file_size (path, error); !error)
+          entry.size += size;
+    }
+
+  std::vector<entry *> order;
+  for (auto &entry : entries)
+    order.push_back (&entry);
+  std::ranges::stable_sort (order, std::ranges::greater{}, &entry::size);
+
+  {
+    thread_pool pool{threads};
+    for (auto *entry : order)
+      pool.submit ([entry, &options] {
+        fmt::memory_buffer buffer;
+        try
+          {
+            entry->status = compare_files (entry->expected.c_str (),
+                                           entry->received.c_str (),
+                                           entry->format, buffer, options);
+            entry->message = fmt::to_string (buffer);
+          }
+        catch (const std::exception &e)
+          {
+            entry->status = 2;
+            entry->message = e.what ();
+          }
+      });
+    pool.wait ();
+  }
+
+  int status = EXIT_SUCCESS;
+  for (auto &entry : entries)
+    {
+      std::string_view message{entry.message};
+      while (message.ends_with ('\n'))
+        message.remove_suffix (1);
+
+      fmt::format_to (std::back_inserter (buffer), "{} {}\n", entry.status,
+                      message);
+      status = std::max (status, entry.status);
+    }
+
+  return status;
+}
+}
+
+#endif /* __OICOMPARE_BATCH_HH__ */
\ No newline at end of file
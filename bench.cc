@@ -0,0 +1,279 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <fmt/format.h>
+#include <unistd.h>
+
+#include "io.hh"
+#include "oicompare.hh"
+
+using namespace std::string_view_literals;
+
+namespace
+{
+/**
+ * A pair of inputs to compare.
+ */
+struct workload
+{
+  std::string first;
+  std::string second;
+};
+
+/**
+ * Many single-digit words, separated by spaces in the first input and by tabs
+ * in the second, so that the inputs are equivalent but not identical.
+ */
+workload
+tiny_tokens (std::size_t size)
+{
+  workload result;
+  for (std::size_t i = 0; result.first.size () < size; ++i)
+    {
+      char digit = static_cast<char> ('0' + i % 10);
+      char separator = i % 16 == 15 ? '\n' : ' ';
+      result.first += digit;
+      result.first += separator;
+      result.second += digit;
+      result.second += separator == ' ' ? '\t' : separator;
+    }
+  return result;
+}
+
+/**
+ * A single word taking the whole input, preceded by a space in the second
+ * one, so that the word is scanned rather than skipped as an identical
+ * prefix.
+ */
+workload
+long_token (std::size_t size)
+{
+  workload result{std::string (size, 'x'), {}};
+  result.second = ' ' + result.first;
+  return result;
+}
+
+/**
+ * Short words separated by long runs of whitespace in the first input, and
+ * by single spaces in the second.
+ */
+workload
+whitespace_heavy (std::size_t size)
+{
+  workload result;
+  for (std::size_t i = 0; result.first.size () < size; ++i)
+    {
+      result.first += "word";
+      result.second += "word";
+      if (i % 8 == 7)
+        {
+          result.first += " \t \r\n";
+          result.second += '\n';
+        }
+      else
+        {
+          result.first.append (60, ' ');
+          result.first += '\t';
+          result.second += ' ';
+        }
+    }
+  return result;
+}
+
+/**
+ * Numbers followed by NUL padding in the first input, as printed by
+ * solutions writing fixed-size records, and separated by spaces in the
+ * second.
+ */
+workload
+nul_padded (std::size_t size)
+{
+  workload result;
+  for (std::size_t i = 0; result.first.size () < size; ++i)
+    {
+      auto number = fmt::to_string (i * 7919 % 1000003);
+      char separator = i % 8 == 7 ? '\n' : ' ';
+      result.first += number;
+      result.first.append (16 - number.size (), '\0');
+      if (separator == '\n')
+        result.first += separator;
+      result.second += number;
+      result.second += separator;
+    }
+  return result;
+}
+
+/**
+ * Lines of numbers, ending in "\r\n" in the second input, so that they are
+ * equivalent but not identical, except for the last word.
+ */
+workload
+late_mismatch (std::size_t size)
+{
+  workload result;
+  for (std::size_t i = 0; result.first.size () < size; ++i)
+    {
+      auto line = fmt::format ("{} {}", i, i * i % 1000003);
+      result.first += line;
+      result.first += '\n';
+      result.second += line;
+      result.second += "\r\n";
+    }
+  result.first += "1\n";
+  result.second += "2\n";
+  return result;
+}
+
+/**
+ * Counts the tokens of an input, including newlines.
+ */
+std::size_t
+count_tokens (std::string_view input)
+{
+  std::size_t count = 0;
+  oicompare::detail::block_scanner scanner{input.data (),
+                                           input.data () + input.size ()};
+  while (scanner.next ().type != oicompare::token_type::eof)
+    ++count;
+  return count;
+}
+
+/**
+ * Returns the shortest time of running a function a number of times.
+ */
+double
+best_time (std::size_t repetitions, const std::function<bool ()> &func,
+           bool &equivalent)
+{
+  auto best = std::chrono::steady_clock::duration::max ();
+  for (std::size_t i = 0; i < repetitions; ++i)
+    {
+      auto start = std::chrono::steady_clock::now ();
+      equivalent = func ();
+      best = std::min (best, std::chrono::steady_clock::now () - start);
+    }
+  return std::chrono::duration<double> (best).count ();
+}
+
+/**
+ * Prints a result as a line of JSON.
+ */
+void
+report (std::string_view workload, std::string_view input, std::size_t bytes,
+        std::size_t tokens, double seconds, bool equivalent)
+{
+  auto gb_per_s = static_cast<double> (bytes) / seconds / 1e9;
+  auto ns_per_token = seconds * 1e9 / static_cast<double> (tokens);
+  fmt::println ("{{\"workload\": \"{}\", \"input\": \"{}\", \"bytes\": {}, "
+                "\"tokens\": {}, \"seconds\": {:.9f}, \"gb_per_s\": {:.3f}, "
+                "\"ns_per_token\": {:.3f}, \"equivalent\": {}}}",
+                workload, input, bytes, tokens, seconds, gb_per_s,
+                ns_per_token, equivalent);
+}
+}
+
+int
+main (int argc, char **argv)
+{
+  std::size_t size_mib = 64;
+  std::size_t repetitions = 5;
+  std::string_view filter;
+
+  for (int i = 1; i < argc; ++i)
+    {
+      std::string_view arg{argv[i]};
+      if (arg.starts_with ("--size="sv))
+        size_mib = std::strtoull (argv[i] + 7, nullptr, 10);
+      else if (arg.starts_with ("--repetitions="sv))
+        repetitions = std::strtoull (argv[i] + 14, nullptr, 10);
+      else if (arg.starts_with ("--filter="sv))
+        filter = arg.substr (9);
+      else
+        {
+          fmt::println (stderr,
+                        "Usage: {} [--size=MIB] [--repetitions=N] "
+                        "[--filter=WORKLOAD]",
+                        argv[0]);
+          return 2;
+        }
+    }
+
+  if (size_mib == 0 || repetitions == 0)
+    {
+      fmt::println (stderr, "The size and repetitions must be positive");
+      return 2;
+    }
+
+  // Each generates a workload of about the given size of each input.
+  const std::pair<std::string_view, workload (*) (std::size_t)> generators[]
+      = {{"tiny_tokens"sv, tiny_tokens},
+         {"long_token"sv, long_token},
+         {"whitespace_heavy"sv, whitespace_heavy},
+         {"nul_padded"sv, nul_padded},
+         {"late_mismatch"sv, late_mismatch}};
+
+  auto directory = std::filesystem::temp_directory_path ()
+                   / fmt::format ("oicompare-bench-{}", ::getpid ());
+  std::filesystem::create_directories (directory);
+
+  int status = EXIT_SUCCESS;
+  try
+    {
+      for (const auto &[name, generate] : generators)
+        {
+          if (!filter.empty () && name != filter)
+            continue;
+
+          auto workload = generate (size_mib << 20);
+
+          auto bytes = workload.first.size () + workload.second.size ();
+          auto tokens = std::max (count_tokens (workload.first),
+                                  std::size_t{1});
+          bool equivalent;
+
+          auto seconds = best_time (
+              repetitions,
+              [&] {
+                return !oicompare::compare (workload.first, workload.second);
+              },
+              equivalent);
+          report (name, "string"sv, bytes, tokens, seconds, equivalent);
+
+          auto first_path = directory / "first";
+          auto second_path = directory / "second";
+          oicompare::io::write_file (first_path.c_str (), workload.first);
+          oicompare::io::write_file (second_path.c_str (), workload.second);
+          workload.first = std::string{};
+          workload.second = std::string{};
+
+          // Mapping is a part of the mmap path.
+          seconds = best_time (
+              repetitions,
+              [&] {
+                oicompare::io::mapped_file first{first_path};
+                oicompare::io::mapped_file second{second_path};
+                return !oicompare::compare (first.contents (),
+                                            second.contents ());
+              },
+              equivalent);
+          report (name, "mmap"sv, bytes, tokens, seconds, equivalent);
+        }
+    }
+  catch (const std::exception &e)
+    {
+      fmt::println (stderr, "{}", e.what ());
+      status = 2;
+    }
+
+  std::filesystem::remove_all (directory);
+  return status;
+}
\ No newline at end of file
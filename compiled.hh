@@ -0,0 +1,335 @@
+#ifndef __OICOMPARE_COMPILED_HH__
+#define __OICOMPARE_COMPILED_HH__
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "hash.hh"
+#include "oicompare.hh"
+
+namespace oicompare
+{
+/**
+ * Precompiled expected output (the .oiexp format).
+ *
+ * The file consists of a header of 64 bytes, the body, padding to a multiple
+ * of 8 bytes and the line index. All the integers are 64-bit little-endian.
+ *
+ *   - 0: magic "OIEXP\0\0\1"
+ *   - 8: size of the body
+ *   - 16: number of newlines in the body
+ *   - 24: number of lines between the entries of the line index
+ *   - 32: number of entries of the line index
+ *   - 40: canonical hash of the body, low and high half
+ *   - 56: reserved, zero
+ *
+ * The body has the tokens of the original output, with the words of a line
+ * separated by a single space and every newline kept. It has exactly the same
+ * tokens and lines as the original, so it is compared instead of it. Entry i
+ * of the line index is the offset of the first character after newline
+ * number i times the stride, making the line of an offset quick to find.
+ *
+ * The canonical hash is that of the body without the newlines at its end.
+ */
+class compiled_expected
+{
+public:
+  /**
+   * Magic bytes at the beginning of the format.
+   */
+  static constexpr std::string_view magic{"OIEXP\0\0\1", 8};
+
+  /**
+   * Number of lines between the entries of the line index.
+   */
+  static constexpr std::size_t default_index_stride = 1024;
+
+  /**
+   * Whether the data looks like the compiled format.
+   */
+  static bool
+  is_compiled (std::string_view data) noexcept
+  {
+    return data.size () >= header_size && data.starts_with (magic);
+  }
+
+  /**
+   * Reads the compiled format, which must outlive the object.
+   *
+   * @param data contents of the file
+   */
+  explicit compiled_expected (std::string_view data)
+  {
+    if (!is_compiled (data))
+      throw std::invalid_argument{"Not a compiled expected output"};
+
+    auto body_size = load (data, 8);
+    newlines_ = load (data, 16);
+    stride_ = load (data, 24);
+    auto index_size = load (data, 32);
+    hash_ = {load (data, 40), load (data, 48)};
+
+    auto index_offset = header_size + (body_size + 7) / 8 * 8;
+    if (body_size > data.size () - header_size
+        || index_offset > data.size () || stride_ == 0 || index_size == 0
+        || index_size > (data.size () - index_offset) / 8)
+      throw std::invalid_argument{"Corrupt compiled expected output"};
+
+    body_ = data.substr (header_size, body_size);
+    index_ = data.substr (index_offset, index_size * 8);
+  }
+
+  /**
+   * The normalized tokens.
+   */
+  std::string_view
+  body () const noexcept
+  {
+    return body_;
+  }
+
+  /**
+   * Number of newlines of the body.
+   */
+  std::size_t
+  newlines () const noexcept
+  {
+    return newlines_;
+  }
+
+  /**
+   * The canonical hash.
+   */
+  hash128
+  hash () const noexcept
+  {
+    return hash_;
+  }
+
+  /**
+   * Number of newlines before an offset of the body.
+   */
+  std::size_t
+  newlines_before (std::size_t offset) const noexcept
+  {
+    // The last entry at or before the offset.
+    std::size_t low = 0, high = index_.size () / 8;
+    while (high - low > 1)
+      {
+        auto middle = (low + high) / 2;
+        if (load (index_, middle * 8) <= offset)
+          low = middle;
+        else
+          high = middle;
+      }
+
+    auto start = std::min<std::size_t> (load (index_, low * 8), offset);
+    return low * stride_
+           + detail::count_newlines (body_.data () + start,
+                                     body_.data () + offset);
+  }
+
+private:
+  static constexpr std::size_t header_size = 64;
+
+  static std::uint64_t
+  load (std::string_view data, std::size_t offset) noexcept
+  {
+    std::uint64_t value = 0;
+    for (std::size_t i = 8; i > 0; --i)
+      value = value << 8 | static_cast<unsigned char> (data[offset + i - 1]);
+    return value;
+  }
+
+  std::string_view body_;
+  std::string_view index_;
+  std::size_t newlines_;
+  std::size_t stride_;
+  hash128 hash_;
+};
+
+namespace detail
+{
+inline void
+store (std::string &out, std::size_t offset, std::uint64_t value) noexcept
+{
+  for (std::size_t i = 0; i < 8; ++i, value >>= 8)
+    out[offset + i] = static_cast<char> (value & 0xFF);
+}
+
+/**
+ * Scans the body of a compiled expected output, where tokens are separated
+ * by exactly one character.
+ */
+class normalized_scanner
+{
+public:
+  normalized_scanner (const char *first, const char *last) noexcept
+      : pos_{first}, last_{last}
+  {
+  }
+
+  token<const char *>
+  next () noexcept
+  {
+    if (pos_ != last_ && *pos_ == ' ')
+      ++pos_;
+
+    if (pos_ == last_)
+      return {token_type::eof, pos_, pos_};
+    else if (*pos_ == '\n')
+      {
+        ++pos_;
+        return {token_type::newline, pos_ - 1, pos_};
+      }
+
+    auto *first = pos_;
+    pos_ = find_word_end (pos_, last_);
+    return {token_type::word, first, pos_};
+  }
+
+private:
+  const char *pos_;
+  const char *last_;
+};
+}
+
+/**
+ * Compiles an expected output into the format read by compiled_expected.
+ *
+ * @param first input begin
+ * @param last input end
+ * @param index_stride number of lines between the entries of the line index
+ * @return contents of the compiled file
+ */
+inline std::string
+compile (const char *first, const char *last,
+         std::size_t index_stride = compiled_expected::default_index_stride)
+{
+  index_stride = std::max (index_stride, std::size_t{1});
+
+  std::string out (64, '\0');
+  std::vector<std::uint64_t> index{0};
+  std::size_t newlines = 0;
+  bool after_word = false;
+
+  detail::block_scanner scanner{first, last};
+  for (auto tok = scanner.next (); tok.type != token_type::eof;
+       tok = scanner.next ())
+    if (tok.type == token_type::newline)
+      {
+        out += '\n';
+        after_word = false;
+        if (++newlines % index_stride == 0)
+          index.push_back (out.size () - 64);
+      }
+    else
+      {
+        if (after_word)
+          out += ' ';
+        out.append (tok.first, tok.last);
+        after_word = true;
+      }
+
+  auto body_size = out.size () - 64;
+  std::string_view body{out.data () + 64, body_size};
+  body = body.substr (0, body.find_last_not_of ('\n') + 1);
+  hasher hasher;
+  hasher.update (body.data (), body.size ());
+  auto hash = hasher.finish ();
+
+  out.resize (out.size () + (8 - body_size % 8) % 8, '\0');
+  auto index_offset = out.size ();
+  out.resize (index_offset + index.size () * 8);
+  for (std::size_t i = 0; i < index.size (); ++i)
+    detail::store (out, index_offset + i * 8, index[i]);
+
+  out.replace (0, compiled_expected::magic.size (), compiled_expected::magic);
+  detail::store (out, 8, body_size);
+  detail::store (out, 16, newlines);
+  detail::store (out, 24, index_stride);
+  detail::store (out, 32, index.size ());
+  detail::store (out, 40, hash.low);
+  detail::store (out, 48, hash.high);
+  return out;
+}
+
+namespace detail
+{
+template <counters_hook Counters>
+std::optional<mismatch<const char *, const char *>>
+compare_compiled (const compiled_expected &expected, const char *first2,
+                  const char *last2, const tolerance *tolerance,
+                  Counters &counters)
+{
+  auto body = expected.body ();
+  auto *first1 = body.data ();
+  auto *last1 = first1 + body.size ();
+  std::size_t size2 = last2 - first2;
+
+  // Outputs printed with single spaces match the body byte by byte.
+  auto prefix = common_prefix (first1, first2, std::min (body.size (), size2));
+  if (prefix == body.size () && prefix == size2)
+    return std::nullopt;
+  prefix = find_last_boundary (first1, first1 + prefix) - first1;
+  counters.skip (prefix);
+
+  normalized_scanner scanner1{first1 + prefix, last1};
+  contiguous_scanner<const char *> scanner2{first2 + prefix, last2};
+  auto result = compare_tokens<const char *, const char *> (
+      scanner1, scanner2, tolerance, counters);
+
+  if (result)
+    result->line_number += expected.newlines_before (prefix);
+
+  return result;
+}
+}
+
+/**
+ * Compares a compiled expected output with an input, returning the mismatch
+ * or none if they are equivalent. The result is the same as that of comparing
+ * the original expected output, with the tokens of the first input pointing
+ * into the body of the compiled one.
+ *
+ * @param expected compiled expected output
+ * @param first2 second input begin
+ * @param last2 second input end
+ * @return mismatch or none
+ */
+inline std::optional<mismatch<const char *, const char *>>
+compare (const compiled_expected &expected, const char *first2,
+         const char *last2)
+{
+  no_counters counters;
+  return detail::compare_compiled (expected, first2, last2, nullptr,
+                                   counters);
+}
+
+/**
+ * Compares a compiled expected output with an input, comparing words which
+ * are numbers with a tolerance.
+ *
+ * @param expected compiled expected output
+ * @param first2 second input begin
+ * @param last2 second input end
+ * @param tolerance tolerance of numbers
+ * @return mismatch or none
+ */
+inline std::optional<mismatch<const char *, const char *>>
+compare (const compiled_expected &expected, const char *first2,
+         const char *last2, const tolerance &tolerance)
+{
+  no_counters counters;
+  return detail::compare_compiled (expected, first2, last2, &tolerance,
+                                   counters);
+}
+}
+
+#endif /* __OICOMPARE_COMPILED_HH__ */
\ No newline at end of file
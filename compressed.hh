@@ -0,0 +1,387 @@
+#ifndef __OICOMPARE_COMPRESSED_HH__
+#define __OICOMPARE_COMPRESSED_HH__
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifdef OICOMPARE_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef OICOMPARE_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "stream.hh"
+
+namespace oicompare
+{
+/**
+ * Compression format of an input.
+ */
+enum class compression
+{
+  none,
+  gzip,
+  zstd,
+};
+
+/**
+ * Detects the compression format of an input from its first bytes.
+ *
+ * @param header at least the first four bytes of the input, if it has them
+ * @return compression format
+ */
+constexpr compression
+detect_compression (std::string_view header) noexcept
+{
+  using namespace std::string_view_literals;
+  if (header.starts_with ("\x1F\x8B"sv))
+    return compression::gzip;
+  else if (header.starts_with ("\x28\xB5\x2F\xFD"sv))
+    return compression::zstd;
+  else
+    return compression::none;
+}
+
+/**
+ * Default size of a chunk of a decompressing_source.
+ */
+constexpr std::size_t default_decompression_chunk_size = std::size_t{1}
+                                                         << 18;
+
+/**
+ * Default number of chunks of a decompressing_source.
+ */
+constexpr std::size_t default_decompression_depth = 4;
+
+/**
+ * A stream source decompressing a gzip or zstd file descriptor.
+ *
+ * A helper thread reads and decompresses the input into a ring of chunks,
+ * which read() copies out of, so that decompression overlaps the comparison.
+ * It waits once all the chunks are full, keeping the memory used bounded by
+ * the depth times the chunk size (and the window of the format). Errors of
+ * the helper thread are thrown by read(), after the data decompressed before
+ * them.
+ */
+class decompressing_source
+{
+public:
+  /**
+   * Starts decompressing a file descriptor owned by the caller, from its
+   * current offset. It must stay open until the source is destroyed.
+   *
+   * @param fd file descriptor
+   * @param format compression format, not none
+   * @param chunk_size size of a chunk
+   * @param depth number of chunks
+   */
+  decompressing_source (
+      int fd, compression format,
+      std::size_t chunk_size = default_decompression_chunk_size,
+      std::size_t depth = default_decompression_depth)
+      : state_{std::make_unique<state> (fd, format, chunk_size, depth)}
+  {
+    state_->thread = std::thread{[state = state_.get ()] { state->run (); }};
+  }
+
+  decompressing_source (decompressing_source &&) noexcept = default;
+  decompressing_source &operator= (decompressing_source &&) noexcept
+      = default;
+
+  ~decompressing_source ()
+  {
+    if (!state_)
+      return;
+
+    {
+      std::lock_guard lock{state_->mutex};
+      state_->stopped = true;
+    }
+    state_->changed.notify_all ();
+    state_->thread.join ();
+  }
+
+  std::size_t
+  read (char *buffer, std::size_t size)
+  {
+    auto &state = *state_;
+    std::unique_lock lock{state.mutex};
+    state.changed.wait (lock,
+                        [&] { return state.filled > 0 || state.finished; });
+    if (state.filled == 0)
+      {
+        if (state.error)
+          std::rethrow_exception (state.error);
+        return 0;
+      }
+    lock.unlock ();
+
+    // The helper thread does not touch a chunk until it is released.
+    auto &chunk = state.chunks[state.head];
+    auto count = std::min (size, chunk.size - state.offset);
+    std::memcpy (buffer, chunk.data.get () + state.offset, count);
+    state.offset += count;
+
+    if (state.offset == chunk.size)
+      {
+        lock.lock ();
+        state.offset = 0;
+        state.head = (state.head + 1) % state.chunks.size ();
+        --state.filled;
+        lock.unlock ();
+        state.changed.notify_all ();
+      }
+    return count;
+  }
+
+private:
+  struct chunk
+  {
+    std::unique_ptr<char[]> data;
+    std::size_t size = 0;
+  };
+
+  /**
+   * Thrown on the helper thread when the source is destroyed.
+   */
+  struct stop
+  {
+  };
+
+  struct state
+  {
+    state (int fd, compression format, std::size_t chunk_size,
+           std::size_t depth)
+        : input{fd}, format{format},
+          chunk_size{std::max (chunk_size, std::size_t{1})},
+          chunks (std::max (depth, std::size_t{1}))
+    {
+      switch (format)
+        {
+        case compression::gzip:
+#ifndef OICOMPARE_HAVE_ZLIB
+          throw std::runtime_error{"Support for gzip was not built in"};
+#endif
+          break;
+        case compression::zstd:
+#ifndef OICOMPARE_HAVE_ZSTD
+          throw std::runtime_error{"Support for zstd was not built in"};
+#endif
+          break;
+        default:
+          throw std::invalid_argument{"The input is not compressed"};
+        }
+
+      for (auto &chunk : chunks)
+        chunk.data.reset (new char[this->chunk_size]);
+    }
+
+    /**
+     * Waits for a free chunk and returns its buffer.
+     */
+    std::span<char>
+    acquire ()
+    {
+      std::unique_lock lock{mutex};
+      changed.wait (lock,
+                    [this] { return filled < chunks.size () || stopped; });
+      if (stopped)
+        throw stop{};
+      return {chunks[(head + filled) % chunks.size ()].data.get (),
+              chunk_size};
+    }
+
+    /**
+     * Hands the chunk returned by acquire() over to read().
+     */
+    void
+    commit (std::size_t size)
+    {
+      {
+        std::lock_guard lock{mutex};
+        chunks[(head + filled) % chunks.size ()].size = size;
+        ++filled;
+      }
+      changed.notify_all ();
+    }
+
+    void
+    run () noexcept
+    {
+      std::exception_ptr failure;
+      try
+        {
+#ifdef OICOMPARE_HAVE_ZLIB
+          if (format == compression::gzip)
+            inflate_gzip ();
+#endif
+#ifdef OICOMPARE_HAVE_ZSTD
+          if (format == compression::zstd)
+            decompress_zstd ();
+#endif
+        }
+      catch (const stop &)
+        {
+        }
+      catch (...)
+        {
+          failure = std::current_exception ();
+        }
+
+      {
+        std::lock_guard lock{mutex};
+        finished = true;
+        error = failure;
+      }
+      changed.notify_all ();
+    }
+
+#ifdef OICOMPARE_HAVE_ZLIB
+    void
+    inflate_gzip ()
+    {
+      struct inflater
+      {
+        z_stream stream{};
+
+        inflater ()
+        {
+          // Detect the gzip header, with the largest window.
+          if (::inflateInit2 (&stream, 15 + 32) != Z_OK)
+            throw std::runtime_error{"Cannot initialize zlib"};
+        }
+
+        ~inflater () { ::inflateEnd (&stream); }
+      } inflater;
+      auto &stream = inflater.stream;
+
+      std::vector<char> buffer (chunk_size);
+      auto out = acquire ();
+      std::size_t used = 0;
+      // Whether the last call might have more output, and whether it ended
+      // a member, after which another one may follow.
+      bool more = false, ended = false;
+      while (true)
+        {
+          if (stream.avail_in == 0 && !more)
+            {
+              auto count = input.read (buffer.data (), buffer.size ());
+              if (count == 0)
+                break;
+              stream.next_in = reinterpret_cast<Bytef *> (buffer.data ());
+              stream.avail_in = static_cast<uInt> (count);
+            }
+          if (ended)
+            {
+              ::inflateReset (&stream);
+              ended = false;
+            }
+
+          stream.next_out = reinterpret_cast<Bytef *> (out.data () + used);
+          stream.avail_out = static_cast<uInt> (out.size () - used);
+          auto status = ::inflate (&stream, Z_NO_FLUSH);
+          if (status == Z_STREAM_END)
+            ended = true;
+          else if (status != Z_OK && status != Z_BUF_ERROR)
+            throw std::runtime_error{"Corrupt gzip input"};
+
+          used = out.size () - stream.avail_out;
+          more = status == Z_OK && used == out.size ();
+          if (used == out.size ())
+            {
+              commit (used);
+              out = acquire ();
+              used = 0;
+            }
+        }
+
+      if (used > 0)
+        commit (used);
+      if (!ended)
+        throw std::runtime_error{"Truncated gzip input"};
+    }
+#endif
+
+#ifdef OICOMPARE_HAVE_ZSTD
+    void
+    decompress_zstd ()
+    {
+      std::unique_ptr<ZSTD_DCtx, decltype (&::ZSTD_freeDCtx)> context{
+          ::ZSTD_createDCtx (), ::ZSTD_freeDCtx};
+      if (!context)
+        throw std::runtime_error{"Cannot initialize zstd"};
+
+      std::vector<char> buffer (chunk_size);
+      ZSTD_inBuffer in{buffer.data (), 0, 0};
+      auto out = acquire ();
+      std::size_t used = 0;
+      // Nonzero in the middle of a frame.
+      std::size_t remaining = 0;
+      bool more = false;
+      while (true)
+        {
+          if (in.pos == in.size && !more)
+            {
+              auto count = input.read (buffer.data (), buffer.size ());
+              if (count == 0)
+                break;
+              in = {buffer.data (), count, 0};
+            }
+
+          ZSTD_outBuffer output{out.data (), out.size (), used};
+          remaining = ::ZSTD_decompressStream (context.get (), &output, &in);
+          if (::ZSTD_isError (remaining))
+            throw std::runtime_error{std::string{"Corrupt zstd input: "}
+                                     + ::ZSTD_getErrorName (remaining)};
+
+          // A call after the end of a frame would begin another one.
+          used = output.pos;
+          more = used == out.size () && remaining != 0;
+          if (used == out.size ())
+            {
+              commit (used);
+              out = acquire ();
+              used = 0;
+            }
+        }
+
+      if (used > 0)
+        commit (used);
+      if (remaining != 0)
+        throw std::runtime_error{"Truncated zstd input"};
+    }
+#endif
+
+    fd_source input;
+    compression format;
+    std::size_t chunk_size;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<chunk> chunks;
+    // The first full chunk, the number of full chunks and the number of bytes
+    // of the first one already read, guarded by the mutex except for the
+    // offset, which only read() uses.
+    std::size_t head = 0, filled = 0, offset = 0;
+    bool finished = false, stopped = false;
+    std::exception_ptr error;
+    std::thread thread;
+  };
+
+  std::unique_ptr<state> state_;
+};
+}
+
+#endif /* __OICOMPARE_COMPRESSED_HH__ */
\ No newline at end of file
@@ -0,0 +1,217 @@
+#ifndef __OICOMPARE_DIGEST_HH__
+#define __OICOMPARE_DIGEST_HH__
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <ranges>
+
+#include "hash.hh"
+#include "oicompare.hh"
+
+namespace oicompare
+{
+namespace detail
+{
+/**
+ * Returns the length of a prefix of an input which is in the canonical form,
+ * with no whitespace other than single spaces between words. It is checked
+ * in blocks of 64 characters.
+ */
+inline std::size_t
+canonical_prefix (const char *first, const char *last) noexcept
+{
+  constexpr std::size_t block_size = 64;
+  std::size_t size = last - first;
+  // Whether the character before the block is a separator, or there is none.
+  std::uint64_t separator_before = 1;
+
+  std::size_t offset = 0;
+  for (; size - offset >= block_size; offset += block_size)
+    {
+      const char *block = first + offset;
+      std::uint64_t whitespace = 0, spaces = 0, newlines = 0;
+      if constexpr (simd::available)
+        for (std::size_t i = 0; i < block_size; i += simd::width)
+          {
+            auto chunk = simd::vector::load (block + i);
+            whitespace |= std::uint64_t{whitespace_bytes (chunk).bits ()} << i;
+            spaces |= std::uint64_t{chunk.eq (' ').bits ()} << i;
+            newlines |= std::uint64_t{chunk.eq ('\n').bits ()} << i;
+          }
+      else
+        for (std::size_t i = 0; i < block_size; ++i)
+          {
+            whitespace |= std::uint64_t{is_whitespace (block[i])} << i;
+            spaces |= std::uint64_t{block[i] == ' '} << i;
+            newlines |= std::uint64_t{block[i] == '\n'} << i;
+          }
+
+      auto separators = spaces | newlines;
+      bool separator_after = offset + block_size == size
+                             || is_whitespace (block[block_size])
+                             || block[block_size] == '\n';
+      auto around = separators << 1 | separator_before | separators >> 1
+                    | std::uint64_t{separator_after} << (block_size - 1);
+      if (whitespace != spaces || (spaces & around) != 0)
+        break;
+
+      separator_before = separators >> (block_size - 1);
+    }
+
+  return offset;
+}
+
+/**
+ * Hashes the canonical form of a token stream: words of a line separated by
+ * a single space, newlines kept except at the end.
+ *
+ * Runs of the input already in the canonical form (which is the common case)
+ * are hashed in bulk instead of token by token.
+ */
+class canonical_hasher
+{
+public:
+  explicit canonical_hasher (const char *first) noexcept
+      : run_{first}, word_end_{first}
+  {
+  }
+
+  /**
+   * Skips the beginning of the input up to a token boundary, which is in the
+   * canonical form, to be hashed in bulk.
+   */
+  void
+  skip (const char *boundary) noexcept
+  {
+    auto *end = boundary;
+    for (; end != run_ && (end[-1] == ' ' || end[-1] == '\n'); --end)
+      newlines_ += end[-1] == '\n';
+
+    if (end != run_)
+      {
+        word_end_ = end;
+        after_word_ = true;
+      }
+  }
+
+  /**
+   * Adds a token of a contiguous input.
+   */
+  void
+  add (const token<const char *> &tok) noexcept
+  {
+    if (tok.type == token_type::newline)
+      {
+        // Only hashed once a word follows.
+        ++newlines_;
+        return;
+      }
+
+    // The canonical separator is the newlines before the word, or a space
+    // after another word.
+    std::size_t gap = tok.first - word_end_;
+    bool canonical = newlines_ > 0 ? gap == newlines_
+                     : after_word_ ? gap == 1 && *word_end_ == ' '
+                                   : gap == 0;
+
+    if (!canonical)
+      {
+        flush ();
+        if (newlines_ > 0)
+          for (std::size_t count = newlines_; count > 0;)
+            {
+              auto size = std::min (count, sizeof (newline_block) - 1);
+              hasher_.update (newline_block, size);
+              count -= size;
+            }
+        else if (after_word_)
+          hasher_.update (" ", 1);
+        run_ = tok.first;
+      }
+
+    word_end_ = tok.last;
+    newlines_ = 0;
+    after_word_ = true;
+  }
+
+  /**
+   * Returns the hash of the tokens so far, without the newlines after the
+   * last word.
+   */
+  hash128
+  finish () noexcept
+  {
+    flush ();
+    return hasher_.finish ();
+  }
+
+private:
+  static constexpr char newline_block[]
+      = "\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n";
+
+  /**
+   * Hashes the run of the input up to the last word, which is in the
+   * canonical form.
+   */
+  void
+  flush () noexcept
+  {
+    if (word_end_ != run_)
+      hasher_.update (run_, word_end_ - run_);
+    run_ = word_end_;
+  }
+
+  hasher hasher_;
+  const char *run_;
+  const char *word_end_;
+  std::size_t newlines_ = 0;
+  bool after_word_ = false;
+};
+}
+
+/**
+ * Computes a 128-bit digest of the tokens of an input, such that equivalent
+ * inputs (as by compare()) have equal digests. It is the canonical hash of a
+ * compiled expected output.
+ *
+ * @param first input begin
+ * @param last input end
+ * @return digest
+ */
+inline hash128
+digest (const char *first, const char *last) noexcept
+{
+  detail::canonical_hasher hasher{first};
+
+  // Most inputs are canonical already, so find where they stop being so
+  // before tokenizing.
+  auto *resume = detail::find_last_boundary (
+      first, first + detail::canonical_prefix (first, last));
+  hasher.skip (resume);
+
+  detail::block_scanner scanner{resume, last};
+
+  for (auto tok = scanner.next (); tok.type != token_type::eof;
+       tok = scanner.next ())
+    hasher.add (tok);
+
+  return hasher.finish ();
+}
+
+/**
+ * Computes a 128-bit digest of the tokens of a contiguous range.
+ *
+ * @param range input
+ * @return digest
+ */
+template <std::ranges::contiguous_range R>
+hash128
+digest (R &&range) noexcept
+{
+  const char *first = std::ranges::data (range);
+  return digest (first, first + std::ranges::size (range));
+}
+}
+
+#endif /* __OICOMPARE_DIGEST_HH__ */
\ No newline at end of file
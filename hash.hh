@@ -0,0 +1,137 @@
+#ifndef __OICOMPARE_HASH_HH__
+#define __OICOMPARE_HASH_HH__
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace oicompare
+{
+/**
+ * A 128-bit hash value.
+ */
+struct hash128
+{
+  std::uint64_t low;
+  std::uint64_t high;
+
+  friend constexpr bool operator== (const hash128 &,
+                                    const hash128 &) noexcept = default;
+};
+
+/**
+ * Computes the 128-bit MurmurHash3 (x64 variant) of data given in any number
+ * of pieces. The result does not depend on how the data is split, nor on the
+ * byte order of the machine.
+ */
+class hasher
+{
+public:
+  /**
+   * Hashes more data.
+   */
+  void
+  update (const char *data, std::size_t size) noexcept
+  {
+    length_ += size;
+
+    if (buffered_ > 0)
+      {
+        auto count = std::min (size, block_size - buffered_);
+        std::memcpy (buffer_ + buffered_, data, count);
+        buffered_ += count;
+        data += count;
+        size -= count;
+        if (buffered_ < block_size)
+          return;
+        mix_block (buffer_);
+        buffered_ = 0;
+      }
+
+    for (; size >= block_size; data += block_size, size -= block_size)
+      mix_block (data);
+
+    std::memcpy (buffer_, data, size);
+    buffered_ = size;
+  }
+
+  /**
+   * Returns the hash of the data so far.
+   */
+  hash128
+  finish () const noexcept
+  {
+    auto h1 = h1_;
+    auto h2 = h2_;
+
+    std::uint64_t k1 = 0, k2 = 0;
+    for (std::size_t i = buffered_; i > 8; --i)
+      k2 = k2 << 8 | static_cast<unsigned char> (buffer_[i - 1]);
+    for (std::size_t i = std::min (buffered_, std::size_t{8}); i > 0; --i)
+      k1 = k1 << 8 | static_cast<unsigned char> (buffer_[i - 1]);
+
+    if (buffered_ > 8)
+      h2 ^= std::rotl (k2 * c2, 33) * c1;
+    if (buffered_ > 0)
+      h1 ^= std::rotl (k1 * c1, 31) * c2;
+
+    h1 ^= length_;
+    h2 ^= length_;
+    h1 += h2;
+    h2 += h1;
+    h1 = fmix (h1);
+    h2 = fmix (h2);
+    h1 += h2;
+    h2 += h1;
+
+    return {h1, h2};
+  }
+
+private:
+  static constexpr std::size_t block_size = 16;
+  static constexpr std::uint64_t c1 = 0x87c37b91114253d5;
+  static constexpr std::uint64_t c2 = 0x4cf5ad432745937f;
+
+  static std::uint64_t
+  load (const char *data) noexcept
+  {
+    std::uint64_t value = 0;
+    for (std::size_t i = 8; i > 0; --i)
+      value = value << 8 | static_cast<unsigned char> (data[i - 1]);
+    return value;
+  }
+
+  static constexpr std::uint64_t
+  fmix (std::uint64_t k) noexcept
+  {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccd;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53;
+    k ^= k >> 33;
+    return k;
+  }
+
+  void
+  mix_block (const char *data) noexcept
+  {
+    auto k1 = load (data);
+    auto k2 = load (data + 8);
+
+    h1_ ^= std::rotl (k1 * c1, 31) * c2;
+    h1_ = (std::rotl (h1_, 27) + h2_) * 5 + 0x52dce729;
+    h2_ ^= std::rotl (k2 * c2, 33) * c1;
+    h2_ = (std::rotl (h2_, 31) + h1_) * 5 + 0x38495ab5;
+  }
+
+  std::uint64_t h1_ = 0;
+  std::uint64_t h2_ = 0;
+  std::uint64_t length_ = 0;
+  char buffer_[block_size];
+  std::size_t buffered_ = 0;
+};
+}
+
+#endif /* __OICOMPARE_HASH_HH__ */
\ No newline at end of file
@@ -0,0 +1,357 @@
+#ifndef __OICOMPARE_INCREMENTAL_HH__
+#define __OICOMPARE_INCREMENTAL_HH__
+
+#include <algorithm>
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+#include "oicompare.hh"
+
+namespace oicompare
+{
+/**
+ * Compares two inputs given in pieces, pushed in any order.
+ *
+ * Tokens are compared as soon as both inputs have them in full, and the data
+ * before them is discarded, so only the tokens not yet matched are kept (all
+ * of them for the input which is ahead). The result is the same as that of
+ * compare() on the concatenated inputs.
+ *
+ * Every feed and finish call returns whether the inputs may still be
+ * equivalent, which stops being the case as soon as a mismatch is certain.
+ * The mismatch itself is reported once its tokens are complete, so the
+ * inputs should be fed or finished until then.
+ *
+ * The memory taken grows with the lead of one input over the other, without
+ * a bound, since all of the lead is kept until the other input catches up.
+ * Callers should feed the inputs in turns, or stop feeding the one which is
+ * ahead while buffered() is more than they can afford.
+ */
+class incremental_comparator
+{
+public:
+  incremental_comparator () = default;
+
+  /**
+   * Compares words which are numbers with a tolerance.
+   *
+   * @param tolerance tolerance of numbers
+   */
+  explicit incremental_comparator (const oicompare::tolerance &tolerance)
+      : tolerance_{tolerance}
+  {
+  }
+
+  /**
+   * Appends data to the first input.
+   *
+   * @param data next piece of the input
+   * @return whether the inputs may still be equivalent
+   */
+  bool
+  feed_first (std::span<const char> data)
+  {
+    return feed (first_, data);
+  }
+
+  /**
+   * Appends data to the second input.
+   *
+   * @param data next piece of the input
+   * @return whether the inputs may still be equivalent
+   */
+  bool
+  feed_second (std::span<const char> data)
+  {
+    return feed (second_, data);
+  }
+
+  /**
+   * Ends the first input.
+   *
+   * @return whether the inputs may still be equivalent
+   */
+  bool
+  finish_first ()
+  {
+    return finish (first_);
+  }
+
+  /**
+   * Ends the second input.
+   *
+   * @return whether the inputs may still be equivalent
+   */
+  bool
+  finish_second ()
+  {
+    return finish (second_);
+  }
+
+  /**
+   * Number of bytes fed but not yet compared, which the comparator keeps.
+   * The data already compared is dropped lazily, so up to twice as much
+   * memory may be taken.
+   */
+  std::size_t
+  buffered () const noexcept
+  {
+    return first_.data.size () - first_.pos + second_.data.size ()
+           - second_.pos;
+  }
+
+  /**
+   * Whether the result is known: a mismatch was reported, or both inputs
+   * were finished.
+   */
+  bool
+  done () const noexcept
+  {
+    return result_ || equivalent_;
+  }
+
+  /**
+   * The mismatch, or none if there is none so far. The tokens point into
+   * the comparator, which is not changed by later calls once it is done.
+   */
+  const std::optional<mismatch<const char *, const char *>> &
+  result () const noexcept
+  {
+    return result_;
+  }
+
+private:
+  struct input
+  {
+    std::string data;
+    // Offset of the data not yet compared, which is at the beginning of a
+    // token or whitespace.
+    std::size_t pos = 0;
+    // Offset up to which the current word is known not to end.
+    std::size_t scanned = 0;
+    bool finished = false;
+
+    const char *
+    begin () const noexcept
+    {
+      return data.data () + pos;
+    }
+
+    const char *
+    end () const noexcept
+    {
+      return data.data () + data.size ();
+    }
+  };
+
+  bool
+  feed (input &in, std::span<const char> data)
+  {
+    if (in.finished)
+      throw std::logic_error{"The input was already finished"};
+    if (done ())
+      return !result_;
+
+    // Drop the compared data once it is most of the buffer.
+    if (in.pos > in.data.size () / 2)
+      {
+        in.data.erase (0, in.pos);
+        in.scanned -= std::min (in.scanned, in.pos);
+        in.pos = 0;
+      }
+
+    in.data.append (data.data (), data.size ());
+    advance ();
+    return !result_ && !certain_;
+  }
+
+  bool
+  finish (input &in)
+  {
+    if (in.finished)
+      throw std::logic_error{"The input was already finished"};
+    in.finished = true;
+    if (!done ())
+      advance ();
+    return !result_ && !certain_;
+  }
+
+  /**
+   * The type of the next token, or none if it is not known yet.
+   */
+  static std::optional<token_type>
+  peek (input &in) noexcept
+  {
+    in.pos = detail::skip_whitespace (in.begin (), in.end ())
+             - in.data.data ();
+    if (in.pos == in.data.size ())
+      return in.finished ? std::optional{token_type::eof} : std::nullopt;
+    else if (in.data[in.pos] == '\n')
+      return token_type::newline;
+    else
+      return token_type::word;
+  }
+
+  /**
+   * The next token of a type, or none if it is a word which may go on.
+   */
+  static std::optional<token<const char *>>
+  current (input &in, token_type type) noexcept
+  {
+    auto *first = in.begin ();
+    switch (type)
+      {
+      case token_type::eof:
+        return token<const char *>{type, first, first};
+      case token_type::newline:
+        return token<const char *>{type, first, first + 1};
+      default:
+        break;
+      }
+
+    auto *last = detail::find_word_end (
+        in.data.data () + std::max (in.scanned, in.pos), in.end ());
+    if (last == in.end () && !in.finished)
+      {
+        in.scanned = in.data.size ();
+        return std::nullopt;
+      }
+    return token<const char *>{type, first, last};
+  }
+
+  /**
+   * Skips the identical prefix of the data of both inputs, up to the
+   * beginning of the token it ends in, without tokenizing it.
+   */
+  void
+  skip_common_prefix () noexcept
+  {
+    auto *first = first_.begin ();
+    auto same = detail::common_prefix (
+        first, second_.begin (),
+        std::min (first_.data.size () - first_.pos,
+                  second_.data.size () - second_.pos));
+    auto *boundary = detail::find_last_boundary (first, first + same);
+    if (boundary == first)
+      return;
+
+    line_number_ += detail::count_newlines (first, boundary);
+    first_.pos += boundary - first;
+    second_.pos += boundary - first;
+    matched_ = 0;
+  }
+
+  /**
+   * Whether the parts of the current words seen so far already differ.
+   */
+  bool
+  words_diverge (const std::optional<token<const char *>> &tok1,
+                 const std::optional<token<const char *>> &tok2) noexcept
+  {
+    // A word which may go on was scanned to the end of its input.
+    std::size_t size1 = (tok1 ? tok1->last : first_.end ()) - first_.begin ();
+    std::size_t size2
+        = (tok2 ? tok2->last : second_.end ()) - second_.begin ();
+    auto size = std::min (size1, size2);
+    matched_ += detail::common_prefix (first_.begin () + matched_,
+                                       second_.begin () + matched_,
+                                       size - matched_);
+    return matched_ < size || (tok1 && size2 > size1)
+           || (tok2 && size1 > size2);
+  }
+
+  /**
+   * Compares the tokens which are complete in both inputs.
+   */
+  void
+  advance ()
+  {
+    skip_common_prefix ();
+    while (true)
+      {
+        auto type1 = peek (first_);
+        auto type2 = peek (second_);
+
+        // Newlines at the end of either input are ignored.
+        if (type1 == token_type::eof && type2 == token_type::newline)
+          {
+            ++second_.pos;
+            continue;
+          }
+        else if (type2 == token_type::eof && type1 == token_type::newline)
+          {
+            ++first_.pos;
+            continue;
+          }
+        else if (!type1 || !type2)
+          return;
+
+        if (*type1 == token_type::eof && *type2 == token_type::eof)
+          {
+            equivalent_ = true;
+            return;
+          }
+        else if (*type1 == token_type::newline
+                 && *type2 == token_type::newline)
+          {
+            ++first_.pos;
+            ++second_.pos;
+            ++line_number_;
+            skip_common_prefix ();
+            continue;
+          }
+
+        auto tok1 = current (first_, *type1);
+        auto tok2 = current (second_, *type2);
+        if (!tok1 || !tok2)
+          {
+            // Numbers may be accepted even if their text differs.
+            certain_ = *type1 != *type2
+                       || (!tolerance_ && words_diverge (tok1, tok2));
+            return;
+          }
+
+        if (auto mismatch = tok1->compare<default_policy> (*tok2))
+          {
+            std::optional<double> difference;
+            if (tolerance_)
+              {
+                bool accepted;
+                std::tie (accepted, difference)
+                    = detail::compare_numbers (*tolerance_, *tok1, *tok2);
+                if (accepted)
+                  mismatch.reset ();
+              }
+
+            if (mismatch)
+              {
+                result_ = {{line_number_, std::move (*mismatch), *tok1,
+                            *tok2, difference}};
+                return;
+              }
+          }
+
+        first_.pos = tok1->last - first_.data.data ();
+        second_.pos = tok2->last - second_.data.data ();
+        matched_ = 0;
+      }
+  }
+
+  std::optional<oicompare::tolerance> tolerance_;
+  input first_;
+  input second_;
+  std::size_t line_number_ = 1;
+  // Length of the identical prefix of the current words seen so far.
+  std::size_t matched_ = 0;
+  // Whether a mismatch is certain, before its tokens are complete.
+  bool certain_ = false;
+  bool equivalent_ = false;
+  std::optional<mismatch<const char *, const char *>> result_;
+};
+}
+
+#endif /* __OICOMPARE_INCREMENTAL_HH__ */
\ No newline at end of file
@@ -0,0 +1,1039 @@
+#ifndef __OICOMPARE_IO_HH__
+#define __OICOMPARE_IO_HH__
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <new>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <mio/mmap.hpp>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "alternatives.hh"
+#include "compiled.hh"
+#include "compressed.hh"
+#include "oicompare.hh"
+#include "parallel.hh"
+#include "stream.hh"
+#include "translations.hh"
+#include "unordered.hh"
+#include "uring.hh"
+#include "window.hh"
+#include "write.hh"
+
+namespace oicompare::io
+{
+/**
+ * How the contents of regular files are brought into memory.
+ */
+enum class read_strategy
+{
+  /**
+   * Small files are read, larger ones are mapped with access hints.
+   */
+  automatic,
+
+  /**
+   * Files are read into memory.
+   */
+  read,
+
+  /**
+   * Files are mapped, without hints.
+   */
+  mmap,
+
+  /**
+   * Files are mapped with access hints, and all of their pages are faulted
+   * in up front.
+   */
+  populate,
+
+  /**
+   * Large files compared in the normal mode are read as streams, with reads
+   * of the next chunks in flight on io_uring (see uring_source) while the
+   * current ones are compared. Other files are read as by automatic.
+   */
+  uring,
+
+  /**
+   * Large files compared in the normal mode are read as streams, through a
+   * window of them mapped at a time (see window_source). Other files are
+   * read as by automatic, which does the same if mapping both files whole
+   * would take more than half of the address space the process may use.
+   */
+  window,
+};
+
+/**
+ * Parses the name of a read strategy.
+ *
+ * @param name name of the strategy: "auto", "read", "mmap", "populate",
+ *             "uring" or "window"
+ * @return strategy or none if the name is unknown
+ */
+inline std::optional<read_strategy>
+parse_read_strategy (std::string_view name) noexcept
+{
+  if (name == "auto")
+    return read_strategy::automatic;
+  else if (name == "read")
+    return read_strategy::read;
+  else if (name == "mmap")
+    return read_strategy::mmap;
+  else if (name == "populate")
+    return read_strategy::populate;
+  else if (name == "uring")
+    return read_strategy::uring;
+  else if (name == "window")
+    return read_strategy::window;
+  else
+    return std::nullopt;
+}
+
+/**
+ * The contents of a regular file, read into memory or memory-mapped.
+ *
+ * Mapping a file and faulting its pages in costs more than reading it if it
+ * is small, so by default small files are read into a buffer inside the
+ * object (which is on the stack as long as the object is), and larger ones
+ * are mapped and read sequentially.
+ */
+class mapped_file
+{
+public:
+  /**
+   * Largest size of files read into the buffer of the object.
+   */
+  static constexpr std::size_t small_size = std::size_t{1} << 16;
+
+  explicit mapped_file (const std::filesystem::path &path,
+                        read_strategy strategy = read_strategy::automatic)
+  {
+    fd_source file{path.c_str ()};
+    load (file.fd (), std::filesystem::file_size (path), strategy);
+  }
+
+  /**
+   * Reads or maps a file open for reading, which stays owned by the caller.
+   *
+   * @param fd file descriptor
+   * @param size size of the file
+   * @param strategy how to bring the file into memory
+   */
+  mapped_file (int fd, std::size_t size,
+               read_strategy strategy = read_strategy::automatic)
+  {
+    load (fd, size, strategy);
+  }
+
+  // The contents may point into the object.
+  mapped_file (const mapped_file &) = delete;
+  mapped_file &operator= (const mapped_file &) = delete;
+
+  /**
+   * The contents of the file.
+   */
+  std::string_view
+  contents () const noexcept
+  {
+    return contents_;
+  }
+
+private:
+  void
+  load (int fd, std::size_t size, read_strategy strategy)
+  {
+    if (size == 0)
+      // mmap() will not let us map something of size 0
+      return;
+
+    if (strategy == read_strategy::read
+        || (strategy != read_strategy::mmap
+            && strategy != read_strategy::populate && size <= small_size))
+      {
+        char *buffer = small_;
+        if (size > small_size)
+          {
+            large_.resize (size);
+            buffer = large_.data ();
+          }
+        contents_ = {buffer, read_at_most (fd, buffer, size)};
+        return;
+      }
+
+    mmap_ = mio::mmap_source{fd, 0, size};
+    contents_ = {mmap_.data (), mmap_.size ()};
+    if (strategy != read_strategy::mmap)
+      advise (strategy == read_strategy::populate);
+  }
+
+  /**
+   * Reads the file from its beginning, without moving its offset, until the
+   * buffer is full or the file ends.
+   */
+  static std::size_t
+  read_at_most (int fd, char *buffer, std::size_t size)
+  {
+    std::size_t count = 0;
+    while (count < size)
+      if (auto result = oicompare::detail::pread_some (
+              fd, buffer + count, size - count, count))
+        count += result;
+      else
+        break;
+    return count;
+  }
+
+  /**
+   * Tells the kernel that the mapping is read sequentially, which makes it
+   * read ahead more, and may be backed by huge pages. The hints are only
+   * hints, so failures are ignored.
+   */
+  void
+  advise (bool populate) noexcept
+  {
+    auto *address = const_cast<char *> (mmap_.data ());
+    ::madvise (address, mmap_.size (), MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+    ::madvise (address, mmap_.size (), MADV_HUGEPAGE);
+#endif
+
+    if (populate)
+      {
+#ifdef MADV_POPULATE_READ
+        if (::madvise (address, mmap_.size (), MADV_POPULATE_READ) == 0)
+          return;
+#endif
+        ::madvise (address, mmap_.size (), MADV_WILLNEED);
+      }
+  }
+
+  std::string_view contents_;
+  mio::mmap_source mmap_;
+  std::string large_;
+  char small_[small_size];
+};
+
+/**
+ * Whether mapping files of a total size would take more than half of the
+ * address space the process may use (RLIMIT_AS), if it is limited.
+ */
+inline bool
+exceeds_address_limit (std::uint64_t size) noexcept
+{
+  struct rlimit limit;
+  return ::getrlimit (RLIMIT_AS, &limit) == 0
+         && limit.rlim_cur != RLIM_INFINITY && size > limit.rlim_cur / 2;
+}
+
+/**
+ * Whether an open regular file begins with the magic bytes of a compiled
+ * expected output.
+ *
+ * @param fd file descriptor
+ */
+inline bool
+is_compiled_file (int fd)
+{
+  char header[compiled_expected::magic.size ()];
+  auto size = oicompare::detail::pread_some (fd, header, sizeof (header), 0);
+  return std::string_view{header, size} == compiled_expected::magic;
+}
+
+/**
+ * Detects the compression format of a regular file from its first bytes,
+ * without moving its offset.
+ */
+inline compression
+file_compression (int fd)
+{
+  char header[4];
+  auto size = oicompare::detail::pread_some (fd, header, sizeof (header), 0);
+  return detect_compression ({header, size});
+}
+
+/**
+ * Drops the pages of a file from the page cache, as far as the system
+ * allows, so that they do not evict the pages of other files.
+ *
+ * @param fd file descriptor of the file, which must not be mapped
+ */
+inline void
+drop_cache ([[maybe_unused]] int fd) noexcept
+{
+#ifdef POSIX_FADV_DONTNEED
+  ::posix_fadvise (fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+}
+
+/**
+ * Size of the smaller of two memory-mapped inputs from which they are
+ * compared in parallel, if more than one thread is allowed.
+ */
+constexpr std::size_t parallel_threshold = std::size_t{1} << 24;
+
+/**
+ * Comparison policy selected at run time.
+ */
+enum class comparison_mode
+{
+  normal,
+  ignore_whitespace,
+  ignore_blank_lines,
+  strict_whitespace,
+  case_insensitive,
+  integer,
+};
+
+/**
+ * Parses the name of a comparison mode.
+ *
+ * @param name name of the mode, like "ignore-blank-lines"
+ * @return mode or none if the name is unknown
+ */
+inline std::optional<comparison_mode>
+parse_mode (std::string_view name) noexcept
+{
+  if (name == "normal")
+    return comparison_mode::normal;
+  else if (name == "ignore-whitespace")
+    return comparison_mode::ignore_whitespace;
+  else if (name == "ignore-blank-lines")
+    return comparison_mode::ignore_blank_lines;
+  else if (name == "strict-whitespace")
+    return comparison_mode::strict_whitespace;
+  else if (name == "case-insensitive")
+    return comparison_mode::case_insensitive;
+  else if (name == "integer")
+    return comparison_mode::integer;
+  else
+    return std::nullopt;
+}
+
+/**
+ * Parses the name of the unit of an unordered comparison.
+ *
+ * @param name name of the unit: "lines" or "tokens"
+ * @return unit or none if the name is unknown
+ */
+inline std::optional<unordered_unit>
+parse_unordered_unit (std::string_view name) noexcept
+{
+  if (name == "lines")
+    return unordered_unit::lines;
+  else if (name == "tokens")
+    return unordered_unit::tokens;
+  else
+    return std::nullopt;
+}
+
+/**
+ * Calls a function with an object of the policy of a comparison mode, so
+ * that it is instantiated for each policy.
+ */
+template <typename Func>
+decltype (auto)
+visit_policy (comparison_mode mode, Func &&func)
+{
+  switch (mode)
+    {
+    case comparison_mode::ignore_whitespace:
+      return std::forward<Func> (func) (ignore_whitespace_policy{});
+    case comparison_mode::ignore_blank_lines:
+      return std::forward<Func> (func) (ignore_blank_lines_policy{});
+    case comparison_mode::strict_whitespace:
+      return std::forward<Func> (func) (strict_whitespace_policy{});
+    case comparison_mode::case_insensitive:
+      return std::forward<Func> (func) (case_insensitive_policy{});
+    case comparison_mode::integer:
+      return std::forward<Func> (func) (integer_policy{});
+    default:
+      return std::forward<Func> (func) (default_policy{});
+    }
+}
+
+/**
+ * How to compare files.
+ */
+struct options
+{
+  /**
+   * Number of threads which may compare large inputs.
+   */
+  std::size_t threads = 1;
+
+  /**
+   * Tolerance of words which are numbers, or none to compare them exactly.
+   */
+  std::optional<oicompare::tolerance> tolerance;
+
+  /**
+   * Comparison policy. Inputs compared with a policy other than the default
+   * one are read whole into memory if they are not regular files.
+   */
+  comparison_mode mode = comparison_mode::normal;
+
+  /**
+   * How regular files are brought into memory.
+   */
+  read_strategy io = read_strategy::automatic;
+
+  /**
+   * Whether the pages of the second (received) file are dropped from the
+   * page cache after the comparison, if it is a regular file larger than
+   * mapped_file::small_size, so that it does not evict expected outputs.
+   */
+  bool drop_received_cache = true;
+
+  /**
+   * If positive, the comparison goes on after every mismatch at the next
+   * line of both inputs, and up to this many of the first mismatches are
+   * formatted, followed by the number of mismatched lines. Inputs which are
+   * not regular files are then read whole into memory.
+   */
+  std::size_t max_mismatches = 0;
+
+  /**
+   * Formats the number of mismatched lines, if max_mismatches is positive.
+   */
+  translations::count_formatter format_count
+      = translations::english_translation<
+          translations::kind::full>::format_count;
+
+  /**
+   * If set, the inputs are compared as multisets of lines or words, in the
+   * normal mode and exactly. Inputs which are not regular files are then
+   * read whole into memory.
+   */
+  std::optional<unordered_unit> unordered;
+};
+
+/**
+ * Opens an input, where "-" is the standard input.
+ */
+inline fd_source
+open_input (const char *path)
+{
+  if (std::string_view{path} == "-")
+    return fd_source{STDIN_FILENO};
+  else
+    return fd_source{path};
+}
+
+/**
+ * Reads a source until its end.
+ */
+template <stream_source Source>
+std::string
+read_contents (Source &source)
+{
+  std::string contents;
+  std::size_t size = 0;
+  while (true)
+    {
+      if (size == contents.size ())
+        contents.resize (std::max (size * 2, default_stream_buffer_size));
+      if (auto count
+          = source.read (contents.data () + size, contents.size () - size))
+        size += count;
+      else
+        break;
+    }
+  contents.resize (size);
+  return contents;
+}
+
+/**
+ * Reads a file descriptor until its end, decompressing it unless the format
+ * is none.
+ */
+inline std::string
+read_contents (int fd, compression format)
+{
+  if (format != compression::none)
+    {
+      decompressing_source source{fd, format};
+      return read_contents (source);
+    }
+
+  fd_source source{fd};
+  return read_contents (source);
+}
+
+/**
+ * Calls a function with the whole contents of a file, where "-" is the
+ * standard input. Regular files are memory-mapped, others and compressed
+ * ones are read into memory.
+ *
+ * @param path path to the file
+ * @param func function taking a std::string_view
+ * @return result of the function
+ */
+template <typename Func>
+decltype (auto)
+with_contents (const char *path, Func &&func)
+{
+  auto file = open_input (path);
+
+  struct stat status;
+  if (::fstat (file.fd (), &status) != 0)
+    throw std::system_error{errno, std::generic_category (), "fstat"};
+
+  auto format = compression::none;
+  if (S_ISREG (status.st_mode))
+    {
+      format = file_compression (file.fd ());
+      if (format == compression::none)
+        {
+          mapped_file mapped{file.fd (),
+                             static_cast<std::size_t> (status.st_size)};
+          return std::forward<Func> (func) (mapped.contents ());
+        }
+    }
+
+  auto contents = read_contents (file.fd (), format);
+  return std::forward<Func> (func) (std::string_view{contents});
+}
+
+/**
+ * Writes a file, replacing its contents.
+ *
+ * @param path path to the file
+ * @param contents new contents
+ */
+inline void
+write_file (const char *path, std::string_view contents)
+{
+  int fd = ::open (path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0)
+    throw std::system_error{errno, std::generic_category (), path};
+
+  try
+    {
+      write_all (fd, contents);
+    }
+  catch (const std::system_error &e)
+    {
+      ::close (fd);
+      throw std::system_error{e.code (), path};
+    }
+
+  if (::close (fd) != 0)
+    throw std::system_error{errno, std::generic_category (), path};
+}
+
+/**
+ * Statistics of comparing two files.
+ */
+struct statistics
+{
+  /**
+   * Bytes of each input mapped or read.
+   */
+  std::array<std::size_t, 2> bytes{};
+
+  /**
+   * Tokens compared, and bytes skipped without tokenizing them.
+   */
+  oicompare::counters counters;
+
+  /**
+   * Time spent mapping the inputs, or reading them into memory.
+   */
+  std::chrono::nanoseconds map_time{};
+
+  /**
+   * Time spent comparing the inputs, including reading streams.
+   */
+  std::chrono::nanoseconds compare_time{};
+
+  /**
+   * Time spent formatting the result.
+   */
+  std::chrono::nanoseconds format_time{};
+
+  /**
+   * Page faults of the process while comparing, as counted by getrusage().
+   */
+  long minor_faults = 0;
+  long major_faults = 0;
+
+  /**
+   * Formats the statistics, one per line in the form "NAME VALUE".
+   */
+  void
+  format (fmt::memory_buffer &buffer) const
+  {
+    auto out = std::back_inserter (buffer);
+    for (std::size_t input = 0; input < 2; ++input)
+      fmt::format_to (out, "bytes{0} {1}\ntokens{0} {2}\nnewlines{0} {3}\n",
+                      input + 1, bytes[input], counters.tokens[input],
+                      counters.newlines[input]);
+    fmt::format_to (out,
+                    "skipped_bytes {}\nmap_ns {}\ncompare_ns {}\n"
+                    "format_ns {}\nminor_faults {}\nmajor_faults {}\n",
+                    counters.skipped, map_time.count (),
+                    compare_time.count (), format_time.count (),
+                    minor_faults, major_faults);
+  }
+};
+
+namespace detail
+{
+/**
+ * Adds the time of every phase to the statistics, if they are not null.
+ */
+class phase_timer
+{
+public:
+  explicit phase_timer (statistics *stats) noexcept : stats_{stats}
+  {
+    if (stats_)
+      start_ = std::chrono::steady_clock::now ();
+  }
+
+  /**
+   * Ends a phase, which began when the previous one ended.
+   */
+  void
+  end (std::chrono::nanoseconds statistics::*phase) noexcept
+  {
+    if (!stats_)
+      return;
+
+    auto now = std::chrono::steady_clock::now ();
+    stats_->*phase += std::chrono::duration_cast<std::chrono::nanoseconds> (
+        now - start_);
+    start_ = now;
+  }
+
+private:
+  statistics *stats_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+template <counters_hook Counters>
+int
+compare_fds (int fd1, int fd2, translations::formatter format,
+             fmt::memory_buffer &buffer, const options &options,
+             std::size_t *bytes, statistics *stats, Counters &counters)
+{
+  if (options.unordered
+      && (options.mode != comparison_mode::normal || options.tolerance
+          || options.max_mismatches > 0))
+    throw std::invalid_argument{"An unordered comparison cannot be combined "
+                                "with a mode, a tolerance or mismatches"};
+
+  phase_timer timer{stats};
+  struct stat stat1, stat2;
+  if (::fstat (fd1, &stat1) != 0 || ::fstat (fd2, &stat2) != 0)
+    throw std::system_error{errno, std::generic_category (), "fstat"};
+
+  std::optional<mapped_file> file1, file2;
+  auto finish = [&] (std::size_t size1, std::size_t size2) {
+    if (bytes)
+      *bytes += size1 + size2;
+    if (stats)
+      stats->bytes = {size1, size2};
+
+    // The pages must be unmapped to be dropped.
+    file2.reset ();
+    if (options.drop_received_cache && S_ISREG (stat2.st_mode)
+        && static_cast<std::size_t> (stat2.st_size) > mapped_file::small_size)
+      drop_cache (fd2);
+  };
+
+  // Compressed files are decompressed as they are read, like pipes.
+  auto compression1 = S_ISREG (stat1.st_mode) ? file_compression (fd1)
+                                              : compression::none;
+  auto compression2 = S_ISREG (stat2.st_mode) ? file_compression (fd2)
+                                              : compression::none;
+  bool mappable1
+      = S_ISREG (stat1.st_mode) && compression1 == compression::none;
+  bool mappable2
+      = S_ISREG (stat2.st_mode) && compression2 == compression::none;
+
+  // Streams of regular files are read ahead, unless the first file is
+  // compiled, which is only compared whole.
+  bool overlapped = options.io == read_strategy::uring
+                    && options.mode == comparison_mode::normal
+                    && options.max_mismatches == 0 && !options.unordered
+                    && mappable1 && mappable2
+                    && static_cast<std::size_t> (stat2.st_size)
+                           > mapped_file::small_size
+                    && !is_compiled_file (fd1);
+
+  // Large files are read through windows, when asked to or when they would
+  // not fit in the address space.
+  bool too_large = exceeds_address_limit (
+      static_cast<std::uint64_t> (stat1.st_size)
+      + static_cast<std::uint64_t> (stat2.st_size));
+  bool windowed
+      = !overlapped && options.mode == comparison_mode::normal
+        && options.max_mismatches == 0 && !options.unordered && mappable1
+        && mappable2
+        && static_cast<std::size_t> (stat2.st_size) > mapped_file::small_size
+        && (options.io == read_strategy::window
+            || (options.io == read_strategy::automatic && too_large))
+        && !is_compiled_file (fd1);
+
+  // Other comparisons map or read the files whole, which may not be
+  // possible.
+  auto map_file = [&] (std::optional<mapped_file> &file, int fd,
+                       const struct stat &status) {
+    auto too_large_error = [] {
+      return std::system_error{ENOMEM, std::generic_category (),
+                               "The files do not fit in the address space, "
+                               "and only the normal mode without mismatches "
+                               "reads them through windows"};
+    };
+
+    try
+      {
+        file.emplace (fd, static_cast<std::size_t> (status.st_size),
+                      options.io);
+      }
+    catch (const std::system_error &e)
+      {
+        if (!too_large || e.code () != std::errc::not_enough_memory)
+          throw;
+        throw too_large_error ();
+      }
+    catch (const std::bad_alloc &)
+      {
+        if (!too_large)
+          throw;
+        throw too_large_error ();
+      }
+  };
+
+  std::string_view data1;
+  std::optional<compiled_expected> compiled;
+  if (mappable1 && !overlapped && !windowed)
+    {
+      map_file (file1, fd1, stat1);
+      data1 = file1->contents ();
+      if (compiled_expected::is_compiled (data1))
+        {
+          compiled.emplace (data1);
+          data1 = compiled->body ();
+        }
+    }
+
+  const auto *tolerance = options.tolerance ? &*options.tolerance : nullptr;
+
+  if (options.mode == comparison_mode::normal && options.max_mismatches == 0
+      && !options.unordered && (!file1 || !mappable2))
+    {
+      auto compare_streams = [&] (auto source1, auto source2) {
+        stream_reader reader1{std::move (source1)};
+        stream_reader reader2{std::move (source2)};
+        timer.end (&statistics::map_time);
+
+        auto result = oicompare::detail::compare_streams (
+            reader1, reader2, tolerance, counters);
+        if (result)
+          {
+            // The tokens of a compiled expected output point into its body.
+            std::optional<std::size_t> offset1;
+            if (!compiled)
+              offset1 = reader1.offset (result->first.first);
+            result->offsets
+                = {offset1, reader2.offset (result->second.first)};
+          }
+        timer.end (&statistics::compare_time);
+        format (buffer, result);
+        timer.end (&statistics::format_time);
+
+        finish (reader1.bytes_read (), reader2.bytes_read ());
+        return result ? EXIT_FAILURE : EXIT_SUCCESS;
+      };
+
+      auto with_source = [] (int fd, compression format, auto &&func) {
+        if (format != compression::none)
+          return func (decompressing_source{fd, format});
+        else
+          return func (fd_source{fd});
+      };
+
+      if (overlapped)
+        return compare_streams (
+            uring_source{fd1, static_cast<std::uint64_t> (stat1.st_size)},
+            uring_source{fd2, static_cast<std::uint64_t> (stat2.st_size)});
+      else if (windowed)
+        return compare_streams (
+            window_source{fd1, static_cast<std::uint64_t> (stat1.st_size)},
+            window_source{fd2, static_cast<std::uint64_t> (stat2.st_size)});
+      else if (file1)
+        return with_source (fd2, compression2, [&] (auto source2) {
+          return compare_streams (view_source{data1}, std::move (source2));
+        });
+      else
+        return with_source (fd1, compression1, [&] (auto source1) {
+          return with_source (fd2, compression2, [&] (auto source2) {
+            return compare_streams (std::move (source1),
+                                    std::move (source2));
+          });
+        });
+    }
+
+  std::string contents1, contents2;
+  if (!file1)
+    data1 = contents1 = read_contents (fd1, compression1);
+
+  std::string_view data2;
+  if (mappable2)
+    {
+      map_file (file2, fd2, stat2);
+      data2 = file2->contents ();
+    }
+  else
+    data2 = contents2 = read_contents (fd2, compression2);
+  timer.end (&statistics::map_time);
+
+  const char *first1 = data1.data (), *last1 = first1 + data1.size ();
+  const char *first2 = data2.data (), *last2 = first2 + data2.size ();
+  // The tokens of a compiled expected output point into its body.
+  auto locate = [&] (mismatch<const char *, const char *> &result) {
+    std::optional<std::size_t> offset1;
+    if (!compiled)
+      offset1 = static_cast<std::size_t> (result.first.first - first1);
+    std::size_t offset2 = result.second.first - first2;
+    result.offsets = {offset1, offset2};
+  };
+
+  // The body of a compiled expected output has the same words and newlines,
+  // but not the same whitespace.
+  if (compiled && options.mode == comparison_mode::strict_whitespace)
+    throw std::invalid_argument{
+        "A compiled expected output cannot be compared strictly"};
+
+  if (options.max_mismatches > 0)
+    {
+      std::vector<mismatch<const char *, const char *>> mismatches;
+      auto lines = visit_policy (options.mode, [&] (auto policy) {
+        return oicompare::detail::compare_all<decltype (policy)> (
+            first1, last1, first2, last2, tolerance, options.max_mismatches,
+            mismatches, counters);
+      });
+      timer.end (&statistics::compare_time);
+      for (auto &mismatch : mismatches)
+        {
+          locate (mismatch);
+          format (buffer, mismatch);
+        }
+      if (lines > 0)
+        options.format_count (buffer, lines);
+      else
+        format (buffer, std::nullopt);
+      timer.end (&statistics::format_time);
+
+      finish (data1.size (), data2.size ());
+      return lines > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+  std::optional<mismatch<const char *, const char *>> result;
+  if (options.unordered)
+    result = compare_unordered (first1, last1, first2, last2,
+                                *options.unordered);
+  else if (options.mode != comparison_mode::normal)
+    {
+      result = visit_policy (options.mode, [&] (auto policy) {
+        return oicompare::detail::compare<decltype (policy)> (
+            first1, last1, first2, last2, tolerance, counters);
+      });
+    }
+  else if (compiled)
+    result = oicompare::detail::compare_compiled (*compiled, first2, last2,
+                                                  tolerance, counters);
+  else if (options.threads > 1
+           && std::min (data1.size (), data2.size ()) >= parallel_threshold)
+    {
+      thread_pool pool{options.threads};
+      result = oicompare::detail::compare_parallel (
+          first1, last1, first2, last2, pool, tolerance,
+          default_parallel_block_size, stats ? &stats->counters : nullptr);
+    }
+  else
+    result = oicompare::detail::compare<default_policy> (
+        first1, last1, first2, last2, tolerance, counters);
+
+  if (result)
+    locate (*result);
+  timer.end (&statistics::compare_time);
+  format (buffer, result);
+  timer.end (&statistics::format_time);
+
+  finish (data1.size (), data2.size ());
+  return result ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+}
+
+/**
+ * Compares two open files, formatting the result into the buffer.
+ *
+ * Regular files are memory-mapped, if either of them is not regular (like a
+ * pipe) or is compressed with gzip or zstd, both are read sequentially as
+ * streams. The first file may be a compiled expected output.
+ *
+ * @param fd1 first file
+ * @param fd2 second file
+ * @param format translation
+ * @param buffer output buffer
+ * @param options how to compare the files
+ * @param bytes if not null, incremented by the sizes of the inputs
+ * @param stats if not null, filled with the statistics of the comparison
+ * @return exit code
+ */
+inline int
+compare_fds (int fd1, int fd2, translations::formatter format,
+             fmt::memory_buffer &buffer, const options &options = {},
+             std::size_t *bytes = nullptr, statistics *stats = nullptr)
+{
+  if (!stats)
+    {
+      // The hot path is not instrumented at all.
+      no_counters counters;
+      return detail::compare_fds (fd1, fd2, format, buffer, options, bytes,
+                                  nullptr, counters);
+    }
+
+  struct rusage before, after;
+  ::getrusage (RUSAGE_SELF, &before);
+  int status = detail::compare_fds (fd1, fd2, format, buffer, options, bytes,
+                                    stats, stats->counters);
+  ::getrusage (RUSAGE_SELF, &after);
+  stats->minor_faults += after.ru_minflt - before.ru_minflt;
+  stats->major_faults += after.ru_majflt - before.ru_majflt;
+  return status;
+}
+
+/**
+ * Compares two files given by their paths, where "-" is the standard input.
+ *
+ * @see compare_fds
+ */
+inline int
+compare_files (const char *path1, const char *path2,
+               translations::formatter format, fmt::memory_buffer &buffer,
+               const options &options = {}, std::size_t *bytes = nullptr,
+               statistics *stats = nullptr)
+{
+  auto file1 = open_input (path1);
+  auto file2 = open_input (path2);
+  return compare_fds (file1.fd (), file2.fd (), format, buffer, options,
+                      bytes, stats);
+}
+
+namespace detail
+{
+/**
+ * Calls a function with the whole contents of all of the files, appended to
+ * a vector, as by with_contents().
+ */
+template <typename Func>
+decltype (auto)
+with_all_contents (std::span<const char *const> paths,
+                   std::vector<std::string_view> &contents, Func &&func)
+{
+  if (paths.empty ())
+    return std::forward<Func> (func) ();
+
+  return with_contents (paths.front (), [&] (std::string_view data) {
+    contents.push_back (data);
+    return with_all_contents (paths.subspan (1), contents,
+                              std::forward<Func> (func));
+  });
+}
+}
+
+/**
+ * Compares a received file with alternatives of the expected file, any of
+ * which is accepted, given by their paths, where "-" is the standard input.
+ * The received file is tokenized once, and the result formatted into the
+ * buffer is that of the alternative which matched, or else of the one which
+ * matched the longest part of the received file. Any of the alternatives may
+ * be compiled.
+ *
+ * @see oicompare::compare_alternatives
+ *
+ * @param received_path path to the received file
+ * @param expected_paths paths to the alternatives, at least one
+ * @param format translation
+ * @param buffer output buffer
+ * @param options how to compare the files, other than unordered or with
+ *                mismatches
+ * @return exit code
+ */
+inline int
+compare_alternative_files (const char *received_path,
+                           std::span<const char *const> expected_paths,
+                           translations::formatter format,
+                           fmt::memory_buffer &buffer,
+                           const options &options = {})
+{
+  if (options.unordered || options.max_mismatches > 0)
+    throw std::invalid_argument{"Alternatives cannot be compared unordered "
+                                "or with mismatches"};
+
+  std::vector<std::string_view> expected;
+  return with_contents (received_path, [&] (std::string_view received) {
+    return detail::with_all_contents (expected_paths, expected, [&] {
+      // The tokens of a compiled expected output point into its body.
+      std::vector<bool> compiled;
+      for (auto &data : expected)
+        {
+          compiled.push_back (compiled_expected::is_compiled (data));
+          if (compiled.back ())
+            data = compiled_expected{data}.body ();
+        }
+      if (options.mode == comparison_mode::strict_whitespace
+          && std::ranges::find (compiled, true) != compiled.end ())
+        throw std::invalid_argument{
+            "A compiled expected output cannot be compared strictly"};
+
+      auto result = visit_policy (options.mode, [&] (auto policy) {
+        using Policy = decltype (policy);
+        if (options.tolerance)
+          return compare_alternatives<Policy> (expected, received,
+                                               *options.tolerance);
+        else
+          return compare_alternatives<Policy> (expected, received);
+      });
+
+      if (auto &mismatch = result.mismatch)
+        {
+          std::optional<std::size_t> offset1;
+          if (!compiled[result.alternative])
+            offset1 = static_cast<std::size_t> (
+                mismatch->first.first - expected[result.alternative].data ());
+          std::size_t offset2 = mismatch->second.first - received.data ();
+          mismatch->offsets = {offset1, offset2};
+        }
+      format (buffer, result.mismatch);
+      return result.mismatch ? EXIT_FAILURE : EXIT_SUCCESS;
+    });
+  });
+}
+}
+
+#endif /* __OICOMPARE_IO_HH__ */
\ No newline at end of file
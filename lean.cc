@@ -0,0 +1,227 @@
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <string_view>
+
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "compiled.hh"
+#include "compressed.hh"
+#include "oicompare.hh"
+#include "translations.hh"
+
+/*
+ * A lean entry point for the common case of comparing two small regular
+ * files, which is dominated by the time from exec to exit rather than by
+ * the comparison itself. It has no static initializers, reads the files with
+ * plain open, fstat and read into static buffers, and formats only the
+ * verdict. Every other case is handed over to the full oicompare by
+ * executing it in place, with the same arguments.
+ */
+
+using namespace std::string_view_literals;
+
+namespace
+{
+/**
+ * Largest size of a file read by the lean path, as the small files of
+ * oicompare::io::mapped_file.
+ */
+constexpr std::size_t lean_size = std::size_t{1} << 16;
+
+char contents1[lean_size];
+char contents2[lean_size];
+char full_path[PATH_MAX];
+
+/**
+ * Writes all of the data.
+ *
+ * @return whether it was written, or false with errno set
+ */
+bool
+write_all (int fd, std::string_view data) noexcept
+{
+  while (!data.empty ())
+    {
+      auto result = ::write (fd, data.data (), data.size ());
+      if (result < 0 && errno != EINTR)
+        return false;
+      else if (result > 0)
+        data.remove_prefix (static_cast<std::size_t> (result));
+    }
+  return true;
+}
+
+/**
+ * Prints an error of a system call in the form of std::system_error.
+ *
+ * @return exit code
+ */
+int
+fail (const char *what, int error) noexcept
+{
+  write_all (STDERR_FILENO, what);
+  write_all (STDERR_FILENO, ": "sv);
+  write_all (STDERR_FILENO, std::strerror (error));
+  write_all (STDERR_FILENO, "\n"sv);
+  return 2;
+}
+
+/**
+ * Executes the full oicompare in place of this process, from the directory
+ * of this executable, or from the search path if it was run from there.
+ */
+[[noreturn]] void
+delegate (char **argv) noexcept
+{
+  std::string_view self{argv[0]};
+  auto slash = self.rfind ('/');
+  if (slash == std::string_view::npos)
+    {
+      argv[0] = const_cast<char *> ("oicompare");
+      ::execvp (argv[0], argv);
+    }
+  else if (slash + sizeof ("/oicompare") <= sizeof (full_path))
+    {
+      std::memcpy (full_path, self.data (), slash);
+      std::memcpy (full_path + slash, "/oicompare", sizeof ("/oicompare"));
+      argv[0] = full_path;
+      ::execv (argv[0], argv);
+    }
+  else
+    errno = ENAMETOOLONG;
+
+  fail ("oicompare", errno);
+  std::_Exit (2);
+}
+
+/**
+ * Opens an input, where "-" is the standard input.
+ *
+ * @return file descriptor, or -1 with errno set
+ */
+int
+open_input (const char *path) noexcept
+{
+  if (path == "-"sv)
+    return STDIN_FILENO;
+  else
+    return ::open (path, O_RDONLY | O_CLOEXEC);
+}
+
+/**
+ * Whether an open file is taken by the lean path: a small regular file,
+ * neither compressed nor compiled. Nothing is read from its offset, so that
+ * the full oicompare can still read all of it, and reports its own errors.
+ *
+ * @param fd file descriptor
+ * @param size set to the size of the file
+ * @return whether it is taken, or nullopt with errno set if fstat failed
+ */
+std::optional<bool>
+is_lean_input (int fd, std::size_t &size) noexcept
+{
+  struct stat status;
+  if (::fstat (fd, &status) != 0)
+    return std::nullopt;
+  if (!S_ISREG (status.st_mode)
+      || static_cast<std::size_t> (status.st_size) > lean_size)
+    return false;
+  size = static_cast<std::size_t> (status.st_size);
+
+  char header[oicompare::compiled_expected::magic.size ()];
+  auto count = ::pread (fd, header, sizeof (header), 0);
+  if (count < 0)
+    return false;
+  std::string_view data{header, static_cast<std::size_t> (count)};
+  return oicompare::detect_compression (data)
+             == oicompare::compression::none
+         && !data.starts_with (oicompare::compiled_expected::magic);
+}
+
+/**
+ * Reads a file of the lean path until its end or the end of the buffer.
+ *
+ * @return number of bytes read, or -1 with errno set
+ */
+ssize_t
+read_input (int fd, char *buffer, std::size_t size) noexcept
+{
+  std::size_t total = 0;
+  while (total < size)
+    {
+      auto count = ::read (fd, buffer + total, size - total);
+      if (count < 0 && errno != EINTR)
+        return -1;
+      else if (count == 0)
+        break;
+      else if (count > 0)
+        total += static_cast<std::size_t> (count);
+    }
+  return static_cast<ssize_t> (total);
+}
+
+/**
+ * Whether an argument is an option, which the lean path does not take.
+ */
+bool
+is_option (std::string_view arg) noexcept
+{
+  return arg.starts_with ('-') && arg != "-"sv;
+}
+}
+
+int
+main (int argc, char **argv)
+{
+  if (argc < 3 || argc > 4 || is_option (argv[1]) || is_option (argv[2]))
+    delegate (argv);
+
+  std::string_view translation_name = argc < 4 ? "english_terse"sv : argv[3];
+  auto format = oicompare::translations::parse (translation_name);
+  if (!format)
+    delegate (argv);
+
+  int fd1 = open_input (argv[1]);
+  if (fd1 < 0)
+    return fail (argv[1], errno);
+  int fd2 = open_input (argv[2]);
+  if (fd2 < 0)
+    return fail (argv[2], errno);
+
+  std::size_t size1 = 0, size2 = 0;
+  auto lean1 = is_lean_input (fd1, size1);
+  auto lean2 = is_lean_input (fd2, size2);
+  if (!lean1 || !lean2)
+    return fail ("fstat", errno);
+  if (!*lean1 || !*lean2)
+    delegate (argv);
+
+  auto count1 = read_input (fd1, contents1, size1);
+  if (count1 < 0)
+    return fail ("read", errno);
+  auto count2 = read_input (fd2, contents2, size2);
+  if (count2 < 0)
+    return fail ("read", errno);
+
+  const char *first1 = contents1, *last1 = first1 + count1;
+  const char *first2 = contents2, *last2 = first2 + count2;
+  auto result = oicompare::compare (first1, last1, first2, last2);
+  if (result)
+    result->offsets
+        = {static_cast<std::size_t> (result->first.first - first1),
+           static_cast<std::size_t> (result->second.first - first2)};
+
+  fmt::memory_buffer buffer;
+  format (buffer, result);
+  // The whole result at once, so that readers never see a part of it.
+  if (!write_all (STDOUT_FILENO, {buffer.data (), buffer.size ()}))
+    return fail ("write", errno);
+  return result ? EXIT_FAILURE : EXIT_SUCCESS;
+}
\ No newline at end of file
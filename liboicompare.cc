@@ -0,0 +1,132 @@
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <new>
+#include <optional>
+#include <string_view>
+
+#include <fmt/format.h>
+
+#include "compiled.hh"
+#include "io.hh"
+#include "liboicompare.h"
+#include "oicompare.hh"
+#include "translations.hh"
+
+using namespace std::string_view_literals;
+
+namespace
+{
+/**
+ * Copies a message into a result, which owns it.
+ */
+int
+finish (oicompare_result *result, int status, std::string_view message)
+{
+  result->status = status;
+  result->message = static_cast<char *> (std::malloc (message.size () + 1));
+  if (!result->message)
+    {
+      result->message_size = 0;
+      return status;
+    }
+  std::memcpy (result->message, message.data (), message.size ());
+  result->message[message.size ()] = '\0';
+  result->message_size = message.size ();
+  return status;
+}
+
+/**
+ * Runs a comparison formatting into a buffer, turning exceptions into
+ * results with the status 2, as no exception may cross the C interface.
+ */
+template <typename Func>
+int
+run (const char *translation, oicompare_result *result, Func &&func) noexcept
+{
+  try
+    {
+      auto name = translation ? std::string_view{translation}
+                              : "english_terse"sv;
+      auto format = oicompare::translations::parse (name);
+      if (!format)
+        return finish (result, 2,
+                       fmt::format ("Unknown translation: {}", name));
+
+      fmt::memory_buffer buffer;
+      int status = func (format, buffer);
+      return finish (result, status, {buffer.data (), buffer.size ()});
+    }
+  catch (const std::bad_alloc &)
+    {
+      result->status = 2;
+      result->message = nullptr;
+      result->message_size = 0;
+      return 2;
+    }
+  catch (const std::exception &e)
+    {
+      return finish (result, 2, e.what ());
+    }
+}
+}
+
+extern "C"
+{
+  const char *
+  oicompare_version (void)
+  {
+    return oicompare::VERSION.data ();
+  }
+
+  int
+  oicompare_compare_files (const char *path1, const char *path2,
+                           const char *translation, oicompare_result *result)
+  {
+    return run (translation, result, [&] (auto format, auto &buffer) {
+      return oicompare::io::compare_files (path1, path2, format, buffer);
+    });
+  }
+
+  int
+  oicompare_compare_buffers (const char *data1, std::size_t size1,
+                             const char *data2, std::size_t size2,
+                             const char *translation,
+                             oicompare_result *result)
+  {
+    return run (translation, result, [&] (auto format, auto &buffer) {
+      const char *first1 = data1, *last1 = data1 + size1;
+      const char *first2 = data2, *last2 = data2 + size2;
+
+      // The tokens of a compiled expected output point into its body.
+      std::optional<oicompare::mismatch<const char *, const char *>> mismatch;
+      std::optional<std::size_t> offset1;
+      if (oicompare::compiled_expected::is_compiled ({data1, size1}))
+        mismatch = oicompare::compare (
+            oicompare::compiled_expected{{data1, size1}}, first2, last2);
+      else
+        {
+          mismatch = oicompare::compare (first1, last1, first2, last2);
+          if (mismatch)
+            offset1 = static_cast<std::size_t> (mismatch->first.first
+                                                - first1);
+        }
+
+      if (mismatch)
+        mismatch->offsets
+            = {offset1,
+               static_cast<std::size_t> (mismatch->second.first - first2)};
+      format (buffer, mismatch);
+      return mismatch ? EXIT_FAILURE : EXIT_SUCCESS;
+    });
+  }
+
+  void
+  oicompare_result_free (oicompare_result *result)
+  {
+    std::free (result->message);
+    result->message = nullptr;
+    result->message_size = 0;
+  }
+}
\ No newline at end of file
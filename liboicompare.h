@@ -0,0 +1,83 @@
+#ifndef __OICOMPARE_LIBOICOMPARE_H__
+#define __OICOMPARE_LIBOICOMPARE_H__
+
+#include <stddef.h>
+
+#if defined(__GNUC__)
+#define OICOMPARE_API __attribute__ ((visibility ("default")))
+#else
+#define OICOMPARE_API
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * Result of a comparison, filled by the comparing functions and released by
+ * oicompare_result_free.
+ */
+struct oicompare_result
+{
+  /**
+   * Exit code of oicompare: 0 if the inputs are equivalent, 1 if they are
+   * not and 2 on an error.
+   */
+  int status;
+
+  /**
+   * Message formatted by the translation, or the description of the error,
+   * terminated by a NUL which is not counted in message_size.
+   */
+  char *message;
+  size_t message_size;
+};
+
+/**
+ * Returns the version of oicompare, as printed by oicompare --version.
+ */
+OICOMPARE_API const char *oicompare_version (void);
+
+/**
+ * Compares two files given by their paths, where "-" is the standard input,
+ * as oicompare FILE1 FILE2 TRANSLATION does.
+ *
+ * @param path1 path to the expected output, which may be compiled
+ * @param path2 path to the received output
+ * @param translation name of the translation, or NULL for english_terse
+ * @param result filled with the result, to be released by the caller
+ * @return status of the result
+ */
+OICOMPARE_API int oicompare_compare_files (const char *path1,
+                                           const char *path2,
+                                           const char *translation,
+                                           struct oicompare_result *result);
+
+/**
+ * Compares two inputs in memory.
+ *
+ * @param data1 expected output, which may be compiled
+ * @param size1 size of the expected output
+ * @param data2 received output
+ * @param size2 size of the received output
+ * @param translation name of the translation, or NULL for english_terse
+ * @param result filled with the result, to be released by the caller
+ * @return status of the result
+ */
+OICOMPARE_API int oicompare_compare_buffers (const char *data1, size_t size1,
+                                             const char *data2, size_t size2,
+                                             const char *translation,
+                                             struct oicompare_result *result);
+
+/**
+ * Releases the message of a result. A released or zeroed result may be
+ * released again.
+ */
+OICOMPARE_API void oicompare_result_free (struct oicompare_result *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __OICOMPARE_LIBOICOMPARE_H__ */
\ No newline at end of file
@@ -0,0 +1,131 @@
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <fmt/format.h>
+#include <unistd.h>
+
+#include "liboicompare.h"
+
+using namespace std::string_view_literals;
+
+/*
+ * Tests the C interface of liboicompare, linked as a shared library.
+ */
+
+namespace
+{
+/**
+ * Checks the status and the message of a result, then releases it (twice,
+ * which is allowed).
+ */
+bool
+check (const char *name, int status, oicompare_result &result,
+       int expected_status, std::string_view expected_message)
+{
+  bool passed = status == expected_status && result.status == expected_status
+                && result.message
+                && std::string_view{result.message, result.message_size}
+                       == expected_message
+                && result.message[result.message_size] == '\0';
+  if (!passed)
+    fmt::println ("{}: got {} \"{}\"", name, result.status,
+                  result.message ? result.message : "(null)");
+
+  oicompare_result_free (&result);
+  oicompare_result_free (&result);
+  return passed && !result.message && result.message_size == 0;
+}
+
+bool
+test_buffers ()
+{
+  auto expected = "1 2\n3\n"sv;
+  auto equal = "1  2\n3"sv;
+  auto wrong = "1 2\n4\n"sv;
+  auto compare = [&] (std::string_view received, const char *translation,
+                      oicompare_result &result) {
+    return oicompare_compare_buffers (expected.data (), expected.size (),
+                                      received.data (), received.size (),
+                                      translation, &result);
+  };
+
+  oicompare_result result{};
+  bool passed = check ("Equal buffers", compare (equal, nullptr, result),
+                       result, 0, "OK\n");
+  passed = check ("Different buffers",
+                  compare (wrong, "english_abbreviated", result), result, 1,
+                  "WRONG: line 2: expected \"3\", got \"4\"\n")
+           && passed;
+  return check ("Unknown translation",
+                compare (equal, "klingon_full", result), result, 2,
+                "Unknown translation: klingon_full")
+         && passed;
+}
+
+bool
+test_files ()
+{
+  auto directory = std::filesystem::temp_directory_path ();
+  auto prefix = fmt::format ("oicompare-libtester-{}", ::getpid ());
+  auto first_path = directory / (prefix + "-1.txt");
+  auto second_path = directory / (prefix + "-2.txt");
+  auto missing_path = directory / (prefix + "-missing.txt");
+  for (const auto &[path, contents] :
+       {std::pair{&first_path, "1 2\n"sv}, std::pair{&second_path, "1 3"sv}})
+    {
+      auto *file = std::fopen (path->c_str (), "wb");
+      if (!file)
+        return false;
+      std::fwrite (contents.data (), 1, contents.size (), file);
+      std::fclose (file);
+    }
+
+  oicompare_result result{};
+  bool passed = check ("Different files",
+                       oicompare_compare_files (first_path.c_str (),
+                                                second_path.c_str (),
+                                                "english_terse", &result),
+                       result, 1, "WRONG\n");
+  passed = check ("Missing file",
+                  oicompare_compare_files (first_path.c_str (),
+                                           missing_path.c_str (), nullptr,
+                                           &result),
+                  result, 2,
+                  fmt::format ("{}: No such file or directory",
+                               missing_path.native ()))
+           && passed;
+
+  std::filesystem::remove (first_path);
+  std::filesystem::remove (second_path);
+  return passed;
+}
+}
+
+int
+main ()
+{
+  if (!oicompare_version () || *oicompare_version () == '\0')
+    {
+      fmt::println ("Version test failed");
+      return 1;
+    }
+
+  if (!test_buffers ())
+    {
+      fmt::println ("Buffer test failed");
+      return 1;
+    }
+
+  if (!test_files ())
+    {
+      fmt::println ("File test failed");
+      return 1;
+    }
+
+  return 0;
+}
\ No newline at end of file
@@ -1,81 +1,280 @@
-#include <algorithm>
 #include <array>
 #include <cctype>
 #include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <csignal>
 #include <cstddef>
 #include <cstdio>
 #include <cstdlib>
-#include <filesystem>
+#include <exception>
 #include <optional>
-#include <string>
 #include <string_view>
+#include <system_error>
+#include <thread>
 #include <utility>
 
 #include <fmt/format.h>
-#include <mio/mmap.hpp>
+#include <signal.h>
+#include <unistd.h>
 
+#include "batch.hh"
+#include "compiled.hh"
+#include "digest.hh"
+#include "io.hh"
 #include "oicompare.hh"
 #include "print_format.hh"
+#include "service.hh"
 #include "translations.hh"
 
 using namespace std::string_view_literals;
 
 namespace
 {
-class mapped_file
+/**
+ * Parses the number of threads, printing an error if it is invalid.
+ */
+bool
+parse_threads (std::string_view arg, std::size_t &threads)
 {
-public:
-  mapped_file (const std::filesystem::path &path) : mmap_{create_mmap (path)}
-  {
-  }
-
-  constexpr const mio::mmap_source &
-  mmap () const noexcept
-  {
-    return mmap_;
-  }
-
-private:
-  static mio::mmap_source
-  create_mmap (const std::filesystem::path &path)
-  {
-    auto size = std::filesystem::file_size (path);
-
-    if (size == 0)
-      // mmap() will not let us map something of size 0
-      return {};
-
-    return {path.native (), 0, size};
-  }
-
-  mio::mmap_source mmap_;
-};
-
-oicompare::translations::translation
-parse_translation (std::string_view name)
+  auto *last = arg.data () + arg.size ();
+  auto [ptr, ec] = std::from_chars (arg.data (), last, threads);
+  if (ec != std::errc{} || ptr != last)
+    {
+      fmt::println (stderr, "Invalid number of threads: {}", arg);
+      return false;
+    }
+  return true;
+}
+
+/**
+ * Parses the maximum number of mismatches, printing an error if it is invalid.
+ */
+bool
+parse_max_mismatches (std::string_view arg, std::size_t &max_mismatches)
+{
+  auto *last = arg.data () + arg.size ();
+  auto [ptr, ec] = std::from_chars (arg.data (), last, max_mismatches);
+  if (ec != std::errc{} || ptr != last || max_mismatches == 0)
+    {
+      fmt::println (stderr, "Invalid number of mismatches: {}", arg);
+      return false;
+    }
+  return true;
+}
+
+/**
+ * Parses a tolerance of numbers, printing an error if it is invalid.
+ */
+bool
+parse_epsilon (const char *arg, double &epsilon)
+{
+  char *end;
+  errno = 0;
+  epsilon = std::strtod (arg, &end);
+  if (*arg == '\0' || *end != '\0' || errno != 0 || !std::isfinite (epsilon)
+      || epsilon < 0)
+    {
+      fmt::println (stderr, "Invalid tolerance: {}", arg);
+      return false;
+    }
+  return true;
+}
+
+/**
+ * Compares the pairs of files listed in a manifest, printing a line for each
+ * of them.
+ *
+ * @see oicompare::io::compare_batch
+ */
+int
+run_batch (const char *manifest_path, std::size_t threads,
+           const oicompare::io::options &options)
+{
+  fmt::memory_buffer buffer;
+  int status;
+  try
+    {
+      status = oicompare::io::compare_batch (manifest_path, buffer, options,
+                                             threads);
+    }
+  catch (const std::exception &e)
+    {
+      fmt::println (stderr, "{}", e.what ());
+      return 2;
+    }
+
+  std::fwrite (buffer.data (), 1, buffer.size (), stdout);
+  return status;
+}
+
+/**
+ * Compiles an expected output to the .oiexp format.
+ */
+int
+run_compile (const char *input_path, const char *output_path)
+{
+  try
+    {
+      auto compiled = oicompare::io::with_contents (
+          input_path, [] (std::string_view contents) {
+            return oicompare::compile (contents.data (),
+                                       contents.data () + contents.size ());
+          });
+      oicompare::io::write_file (output_path, compiled);
+    }
+  catch (const std::system_error &e)
+    {
+      fmt::println (stderr, "{}", e.what ());
+      return 2;
+    }
+
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Prints the digest of a file, or the hash of a compiled expected output.
+ */
+int
+run_digest (const char *path)
+{
+  try
+    {
+      auto hash = oicompare::io::with_contents (
+          path, [] (std::string_view contents) {
+            if (oicompare::compiled_expected::is_compiled (contents))
+              return oicompare::compiled_expected{contents}.hash ();
+            else
+              return oicompare::digest (contents);
+          });
+      fmt::println ("{:016x}{:016x}", hash.high, hash.low);
+    }
+  catch (const std::exception &e)
+    {
+      fmt::println (stderr, "{}", e.what ());
+      return 2;
+    }
+
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Serves comparisons on a Unix domain socket until SIGINT or SIGTERM.
+ *
+ * @see oicompare::service::server
+ */
+int
+run_server (const char *socket_path, std::size_t threads)
 {
-  using namespace oicompare::translations;
-
-  if (name == "english_abbreviated"sv)
-    return english_translation<kind::abbreviated>::print;
-  else if (name == "english_full"sv)
-    return english_translation<kind::full>::print;
-  else if (name == "english_terse"sv)
-    return english_translation<kind::terse>::print;
-  else if (name == "polish_abbreviated"sv)
-    return polish_translation<kind::abbreviated>::print;
-  else if (name == "polish_full"sv)
-    return polish_translation<kind::full>::print;
-  else if (name == "polish_terse"sv)
-    return polish_translation<kind::terse>::print;
-  else
-    return nullptr;
+  // Block the signals in all threads, so that they are only taken by sigwait.
+  sigset_t signals;
+  sigemptyset (&signals);
+  sigaddset (&signals, SIGINT);
+  sigaddset (&signals, SIGTERM);
+  pthread_sigmask (SIG_BLOCK, &signals, nullptr);
+  // Clients going away should only fail their connections.
+  std::signal (SIGPIPE, SIG_IGN);
+
+  std::optional<oicompare::service::server> server;
+  try
+    {
+      server.emplace (socket_path, threads);
+    }
+  catch (const std::system_error &e)
+    {
+      fmt::println (stderr, "{}", e.what ());
+      return 2;
+    }
+
+  std::thread waiter{[&] {
+    int signal;
+    sigwait (&signals, &signal);
+    server->stop ();
+  }};
+
+  server->run ();
+  waiter.join ();
+
+  fmt::memory_buffer buffer;
+  server->statistics ().format (buffer);
+  std::fwrite (buffer.data (), 1, buffer.size (), stderr);
+  return EXIT_SUCCESS;
 }
 }
 
 int
 main (int argc, char **argv)
 {
+  // Options come first, and are shifted out of the arguments.
+  oicompare::io::options options;
+  oicompare::tolerance tolerance;
+  std::string_view translation_name = "english_terse"sv;
+  bool print_stats = false;
+  while (argc > 1)
+    {
+      std::string_view arg{argv[1]};
+      const char *value = argv[1] + arg.find ('=') + 1;
+      if (arg.starts_with ("--mode="sv))
+        {
+          auto mode = oicompare::io::parse_mode (value);
+          if (!mode)
+            {
+              fmt::println (stderr, "Unknown mode: {}", value);
+              return 2;
+            }
+          options.mode = *mode;
+        }
+      else if (arg.starts_with ("--abs-epsilon="sv))
+        {
+          if (!parse_epsilon (value, tolerance.absolute))
+            return 2;
+          options.tolerance = tolerance;
+        }
+      else if (arg.starts_with ("--rel-epsilon="sv))
+        {
+          if (!parse_epsilon (value, tolerance.relative))
+            return 2;
+          options.tolerance = tolerance;
+        }
+      else if (arg.starts_with ("--io="sv))
+        {
+          auto strategy = oicompare::io::parse_read_strategy (value);
+          if (!strategy)
+            {
+              fmt::println (stderr, "Unknown I/O strategy: {}", value);
+              return 2;
+            }
+          options.io = *strategy;
+        }
+      else if (arg.starts_with ("--max-mismatches="sv))
+        {
+          if (!parse_max_mismatches (value, options.max_mismatches))
+            return 2;
+        }
+      else if (arg.starts_with ("--unordered="sv))
+        {
+          auto unit = oicompare::io::parse_unordered_unit (value);
+          if (!unit)
+            {
+              fmt::println (stderr, "Unknown unordered unit: {}", value);
+              return 2;
+            }
+          options.unordered = *unit;
+        }
+      else if (arg.starts_with ("--translation="sv))
+        translation_name = value;
+      else if (arg == "--keep-cache"sv)
+        options.drop_received_cache = false;
+      else if (arg == "--stats"sv)
+        print_stats = true;
+      else
+        break;
+
+      argv[1] = argv[0];
+      ++argv;
+      --argc;
+    }
+
   if (argc == 2
       && (std::string_view{argv[1]} == "--version"sv
           || std::string_view{argv[1]} == "-v"sv))
@@ -83,28 +282,138 @@ main (int argc, char **argv)
       fmt::println ("oicompare version {}", oicompare::VERSION);
       return EXIT_SUCCESS;
     }
+  if ((argc == 3 || argc == 4) && std::string_view{argv[1]} == "--batch"sv)
+    {
+      std::size_t threads = std::thread::hardware_concurrency ();
+      if (argc == 4 && !parse_threads (argv[3], threads))
+        return 2;
+      // Every pair gets a single line.
+      if (options.max_mismatches > 0)
+        {
+          fmt::println (stderr,
+                        "--max-mismatches cannot be used with --batch");
+          return 2;
+        }
+
+      return run_batch (argv[2], threads, options);
+    }
+  if (argc == 3 && std::string_view{argv[1]} == "--digest"sv)
+    return run_digest (argv[2]);
+  if (argc == 4 && std::string_view{argv[1]} == "--compile"sv)
+    return run_compile (argv[2], argv[3]);
+  if ((argc == 3 || argc == 4) && std::string_view{argv[1]} == "--serve"sv)
+    {
+      std::size_t threads = std::thread::hardware_concurrency ();
+      if (argc == 4 && !parse_threads (argv[3], threads))
+        return 2;
+
+      return run_server (argv[2], threads);
+    }
+  if (argc >= 4 && std::string_view{argv[2]} == "--"sv)
+    {
+      auto format = oicompare::translations::parse (translation_name);
+      if (!format)
+        {
+          fmt::println (stderr, "Unknown translation: {}", translation_name);
+          return 2;
+        }
+      if (print_stats)
+        {
+          fmt::println (stderr, "--stats cannot be used with alternatives");
+          return 2;
+        }
+
+      fmt::memory_buffer buffer;
+      try
+        {
+          int status = oicompare::io::compare_alternative_files (
+              argv[1],
+              {argv + 3, static_cast<std::size_t> (argc - 3)}, format,
+              buffer, options);
+          oicompare::io::write_all (STDOUT_FILENO,
+                                    {buffer.data (), buffer.size ()});
+          return status;
+        }
+      catch (const std::exception &e)
+        {
+          fmt::println (stderr, "{}", e.what ());
+          return 2;
+        }
+    }
   if (argc < 3 || argc > 4) [[unlikely]]
     {
-      fmt::println (stderr, "Usage: {} FILE1 FILE2 [TRANSLATION]", argv[0]);
+      fmt::println (stderr,
+                    "Usage: {0} [OPTION]... FILE1 FILE2 [TRANSLATION]\n"
+                    "       {0} [OPTION]... RECEIVED -- EXPECTED...\n"
+                    "       {0} --compile EXPECTED OUTPUT\n"
+                    "       {0} --digest FILE\n"
+                    "       {0} [OPTION]... --batch MANIFEST [THREADS]\n"
+                    "       {0} --serve SOCKET [THREADS]\n"
+                    "Options:\n"
+                    "  --abs-epsilon=X  accept numbers off by at most X\n"
+                    "  --rel-epsilon=Y  accept numbers off by at most Y\n"
+                    "                   times the expected one\n"
+                    "  --mode=MODE      normal, ignore-whitespace,\n"
+                    "                   ignore-blank-lines,\n"
+                    "                   strict-whitespace,\n"
+                    "                   case-insensitive or integer\n"
+                    "  --unordered=UNIT lines or tokens, compare the files\n"
+                    "                   as multisets of them\n"
+                    "  --io=STRATEGY    auto, read, mmap, populate, uring\n"
+                    "                   or window\n"
+                    "  --keep-cache     keep FILE2 in the page cache\n"
+                    "  --max-mismatches=K\n"
+                    "                   go on after mismatches at the next\n"
+                    "                   line, print the first K of them\n"
+                    "                   and the number of mismatched lines\n"
+                    "  --translation=NAME\n"
+                    "                   translation if it is not given\n"
+                    "                   after the files\n"
+                    "  --stats          print statistics of the comparison\n"
+                    "                   to the standard error",
+                    argv[0]);
       return 2;
     }
 
-  mapped_file file1{argv[1]};
-  mapped_file file2{argv[2]};
+  if (argc == 4)
+    translation_name = argv[3];
+  auto format = oicompare::translations::parse (translation_name);
 
-  std::string_view translation_name = argc < 4 ? "english_terse"sv : argv[3];
-  oicompare::translations::translation translation;
-
-  if (auto parsed_translation = parse_translation (translation_name))
-    translation = parsed_translation;
-  else
+  if (!format)
     {
       fmt::println (stderr, "Unknown translation: {}", translation_name);
       return 2;
     }
 
-  auto result = oicompare::compare (file1.mmap (), file2.mmap ());
-  translation (result);
+  options.format_count
+      = oicompare::translations::parse_count (translation_name);
+
+  fmt::memory_buffer buffer;
+  options.threads = std::thread::hardware_concurrency ();
+  oicompare::io::statistics stats;
+  int status;
+  try
+    {
+      status = oicompare::io::compare_files (
+          argv[1], argv[2], format, buffer, options, nullptr,
+          print_stats ? &stats : nullptr);
+
+      // The whole result at once, so that readers never see a part of it.
+      oicompare::io::write_all (STDOUT_FILENO,
+                                {buffer.data (), buffer.size ()});
+    }
+  catch (const std::exception &e)
+    {
+      fmt::println (stderr, "{}", e.what ());
+      return 2;
+    }
+
+  if (print_stats)
+    {
+      buffer.clear ();
+      stats.format (buffer);
+      std::fwrite (buffer.data (), 1, buffer.size (), stderr);
+    }
 
-  return result ? EXIT_FAILURE : EXIT_SUCCESS;
+  return status;
 }
\ No newline at end of file
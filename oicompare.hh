@@ -2,17 +2,36 @@
 #define __OICOMPARE_HH__
 
 #include <algorithm>
+#include <array>
+#include <bit>
+#include <cerrno>
+#include <charconv>
+#include <cmath>
 #include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <iterator>
+#include <limits>
+#include <memory>
 #include <optional>
 #include <ranges>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <tuple>
 #include <type_traits>
 #include <utility>
+#include <vector>
+
+#include "simd.hh"
 
 namespace oicompare
 {
 
-const std::string VERSION = "1.0.2";
+// A constant, so that it takes no static initializer.
+constexpr std::string_view VERSION{"1.0.2"};
 
 namespace detail
 {
@@ -22,6 +41,61 @@ is_whitespace (char ch) noexcept
   return ch == '\0' || ch == '\t' || ch == '\v' || ch == '\r' || ch == ' ';
 }
 
+/**
+ * Class of a character, as seen by the tokenizer.
+ */
+enum class char_class : std::uint8_t
+{
+  word,
+  whitespace,
+  newline,
+};
+
+using char_class_table = std::array<char_class, 256>;
+
+/**
+ * Builds the table of character classes, where the whitespace characters are
+ * those of is_whitespace and LF is either a newline or whitespace.
+ */
+constexpr char_class_table
+make_char_classes (bool newline_is_whitespace) noexcept
+{
+  char_class_table table{};
+  for (int ch = 0; ch < 256; ++ch)
+    if (is_whitespace (static_cast<char> (ch)))
+      table[ch] = char_class::whitespace;
+  table['\n']
+      = newline_is_whitespace ? char_class::whitespace : char_class::newline;
+  return table;
+}
+
+/**
+ * Whether two tables of character classes are the same. Unlike operator==
+ * of std::array, it is a constant expression with the debug mode of
+ * libstdc++.
+ */
+constexpr bool
+same_char_classes (const char_class_table &table1,
+                   const char_class_table &table2) noexcept
+{
+  for (std::size_t ch = 0; ch < table1.size (); ++ch)
+    if (table1[ch] != table2[ch])
+      return false;
+  return true;
+}
+
+/**
+ * Table mapping ASCII letters to lower case, and other characters to
+ * themselves.
+ */
+constexpr auto lower_case_table = [] {
+  std::array<char, 256> table{};
+  for (int ch = 0; ch < 256; ++ch)
+    table[ch] = static_cast<char> (ch >= 'A' && ch <= 'Z' ? ch - 'A' + 'a'
+                                                          : ch);
+  return table;
+}();
+
 template <typename It>
 concept char_iterator
     = std::forward_iterator<It>
@@ -32,6 +106,398 @@ concept char_range
     = std::ranges::forward_range<R>
       && std::convertible_to<std::ranges::range_reference_t<R>, char>
       && char_iterator<std::ranges::iterator_t<R>>;
+
+template <typename It, typename Sent>
+concept contiguous_char_input
+    = std::contiguous_iterator<It> && std::sized_sentinel_for<Sent, It>
+      && std::same_as<std::iter_value_t<It>, char>;
+
+/**
+ * Marks the whitespace characters of a vector.
+ */
+inline simd::vector
+whitespace_bytes (const simd::vector &chunk) noexcept
+{
+  return chunk.eq ('\0') | chunk.eq ('\t') | chunk.eq ('\v')
+         | chunk.eq ('\r') | chunk.eq (' ');
+}
+
+/**
+ * Returns the length of the common prefix of two arrays of the given size.
+ */
+inline std::size_t
+common_prefix (const char *first1, const char *first2,
+               std::size_t size) noexcept
+{
+  std::size_t i = 0;
+
+  if constexpr (simd::available)
+    {
+      constexpr std::size_t stride = 4 * simd::width;
+      for (; size - i >= stride; i += stride)
+        {
+          auto equal = simd::vector::load (first1 + i)
+                           .eq (simd::vector::load (first2 + i));
+          for (std::size_t j = simd::width; j < stride; j += simd::width)
+            equal = equal
+                    & simd::vector::load (first1 + i + j)
+                          .eq (simd::vector::load (first2 + i + j));
+          if (static_cast<std::size_t> (std::countr_one (equal.bits ()))
+              < simd::width)
+            break;
+        }
+
+      for (; size - i >= simd::width; i += simd::width)
+        {
+          auto equal = simd::vector::load (first1 + i)
+                           .eq (simd::vector::load (first2 + i))
+                           .bits ();
+          if (auto same = static_cast<std::size_t> (std::countr_one (equal));
+              same < simd::width)
+            return i + same;
+        }
+    }
+
+  while (i < size && first1[i] == first2[i])
+    ++i;
+  return i;
+}
+
+/**
+ * Returns the length of the prefix of an array which is decimal digits.
+ */
+inline std::size_t
+digit_prefix (const char *first, std::size_t size) noexcept
+{
+  std::size_t i = 0;
+
+  if constexpr (simd::available)
+    for (; size - i >= simd::width; i += simd::width)
+      {
+        auto digits
+            = simd::vector::load (first + i).between ('0', '9').bits ();
+        if (auto count = static_cast<std::size_t> (std::countr_one (digits));
+            count < simd::width)
+          return i + count;
+      }
+
+  while (i < size && first[i] >= '0' && first[i] <= '9')
+    ++i;
+  return i;
+}
+
+/**
+ * Returns the length of the prefix of an array which is a character.
+ */
+inline std::size_t
+char_prefix (const char *first, std::size_t size, char ch) noexcept
+{
+  std::size_t i = 0;
+
+  if constexpr (simd::available)
+    for (; size - i >= simd::width; i += simd::width)
+      {
+        auto same = simd::vector::load (first + i).eq (ch).bits ();
+        if (auto count = static_cast<std::size_t> (std::countr_one (same));
+            count < simd::width)
+          return i + count;
+      }
+
+  while (i < size && first[i] == ch)
+    ++i;
+  return i;
+}
+
+/**
+ * Finds the beginning of the token which contains the character before
+ * last, that is the position after the last whitespace or newline in the
+ * range, or first if there is none.
+ */
+inline const char *
+find_last_boundary (const char *first, const char *last) noexcept
+{
+  if constexpr (simd::available)
+    for (; static_cast<std::size_t> (last - first) >= simd::width;
+         last -= simd::width)
+      {
+        auto chunk = simd::vector::load (last - simd::width);
+        auto boundary = (whitespace_bytes (chunk) | chunk.eq ('\n')).bits ();
+        if (boundary)
+          return last - simd::width + std::bit_width (boundary);
+      }
+
+  while (last != first && !is_whitespace (last[-1]) && last[-1] != '\n')
+    --last;
+  return last;
+}
+
+/**
+ * Counts the newline characters in a range.
+ */
+inline std::size_t
+count_newlines (const char *first, const char *last) noexcept
+{
+  std::size_t count = 0;
+
+  if constexpr (simd::available)
+    for (; static_cast<std::size_t> (last - first) >= simd::width;
+         first += simd::width)
+      count += std::popcount (simd::vector::load (first).eq ('\n').bits ());
+
+  return count + std::count (first, last, '\n');
+}
+
+/**
+ * Finds the first character which is not whitespace, or last.
+ */
+inline const char *
+skip_whitespace (const char *first, const char *last) noexcept
+{
+  if constexpr (simd::available)
+    for (; static_cast<std::size_t> (last - first) >= simd::width;
+         first += simd::width)
+      {
+        auto other = ~whitespace_bytes (simd::vector::load (first)).bits ();
+        if (auto same = static_cast<std::size_t> (std::countr_zero (other));
+            same < simd::width)
+          return first + same;
+      }
+
+  while (first != last && is_whitespace (*first))
+    ++first;
+  return first;
+}
+
+/**
+ * Finds the first whitespace or newline character, or last.
+ */
+inline const char *
+find_word_end (const char *first, const char *last) noexcept
+{
+  if constexpr (simd::available)
+    for (; static_cast<std::size_t> (last - first) >= simd::width;
+         first += simd::width)
+      {
+        auto chunk = simd::vector::load (first);
+        auto boundary = (whitespace_bytes (chunk) | chunk.eq ('\n')).bits ();
+        if (boundary)
+          return first + std::countr_zero (boundary);
+      }
+
+  while (first != last && !is_whitespace (*first) && *first != '\n')
+    ++first;
+  return first;
+}
+
+/**
+ * Finds the beginning of the trailing whitespace and newlines of a range,
+ * that is the position after its last other character, or first if there
+ * is none. It is scanned backwards, from last.
+ */
+inline const char *
+trailing_whitespace (const char *first, const char *last) noexcept
+{
+  if constexpr (simd::available)
+    {
+      auto blank = [] (const char *ptr) {
+        auto chunk = simd::vector::load (ptr);
+        return whitespace_bytes (chunk) | chunk.eq ('\n');
+      };
+
+      constexpr std::size_t stride = 4 * simd::width;
+      for (; static_cast<std::size_t> (last - first) >= stride;
+           last -= stride)
+        {
+          auto all = blank (last - stride);
+          for (std::size_t j = simd::width; j < stride; j += simd::width)
+            all = all & blank (last - stride + j);
+          if (static_cast<std::size_t> (std::popcount (all.bits ()))
+              < simd::width)
+            break;
+        }
+
+      constexpr auto lanes = static_cast<simd::mask> (
+          ~simd::mask{} >> (std::numeric_limits<simd::mask>::digits
+                            - simd::width));
+      for (; static_cast<std::size_t> (last - first) >= simd::width;
+           last -= simd::width)
+        if (auto other = ~blank (last - simd::width).bits () & lanes)
+          return last - simd::width + std::bit_width (other);
+    }
+
+  while (last != first && (is_whitespace (last[-1]) || last[-1] == '\n'))
+    --last;
+  return last;
+}
+}
+
+/**
+ * The default comparison policy: words are separated by whitespace (NUL, tab,
+ * vertical tab, CR and space), newlines are significant except at the end of
+ * the input, and words are compared byte by byte.
+ *
+ * A policy is a type passed as a template argument to compare(), so that
+ * each of them gets its own tokenizer. The other policies derive from this
+ * one, overriding some of its members.
+ */
+struct default_policy
+{
+  /**
+   * Classes of the characters. Vector kernels only support the whitespace
+   * characters of this table, with LF being either a newline or whitespace.
+   */
+  static constexpr detail::char_class_table classes
+      = detail::make_char_classes (false);
+
+  /**
+   * Whether newlines ending blank lines (with no words) are ignored.
+   */
+  static constexpr bool ignore_blank_lines = false;
+
+  /**
+   * Whether whitespace at the end of a line, and newlines at the end of the
+   * input, are significant.
+   */
+  static constexpr bool strict_trailing_whitespace = false;
+
+  /**
+   * Whether ASCII letters of words are compared ignoring case.
+   */
+  static constexpr bool case_insensitive = false;
+
+  /**
+   * Whether words which are integers are compared by their values, ignoring
+   * a plus sign, leading zeros and the sign of zero.
+   */
+  static constexpr bool integer_values = false;
+};
+
+/**
+ * Policy ignoring all whitespace, including newlines: only the sequence of
+ * words is compared.
+ */
+struct ignore_whitespace_policy : default_policy
+{
+  static constexpr detail::char_class_table classes
+      = detail::make_char_classes (true);
+};
+
+/**
+ * Policy ignoring blank lines anywhere in the input.
+ */
+struct ignore_blank_lines_policy : default_policy
+{
+  static constexpr bool ignore_blank_lines = true;
+};
+
+/**
+ * Policy requiring whitespace at the ends of lines, and newlines at the end
+ * of the input, to be the same. Whitespace between words is still ignored.
+ */
+struct strict_whitespace_policy : default_policy
+{
+  static constexpr bool strict_trailing_whitespace = true;
+};
+
+/**
+ * Policy comparing words ignoring the case of ASCII letters.
+ */
+struct case_insensitive_policy : default_policy
+{
+  static constexpr bool case_insensitive = true;
+};
+
+/**
+ * Policy comparing words which are integers of any length by their values,
+ * so that "+5", "05" and "5" are equal, and so are "-0" and "0".
+ */
+struct integer_policy : default_policy
+{
+  static constexpr bool integer_values = true;
+};
+
+namespace detail
+{
+template <typename Policy>
+constexpr char_class
+classify (char ch) noexcept
+{
+  return Policy::classes[static_cast<unsigned char> (ch)];
+}
+
+/**
+ * Whether LF is a whitespace character rather than a token of a policy.
+ */
+template <typename Policy>
+constexpr bool newline_is_whitespace
+    = Policy::classes['\n'] == char_class::whitespace;
+
+/**
+ * An integer word split into its sign and its digits without leading zeros.
+ */
+template <typename It> struct integer_parts
+{
+  /**
+   * Whether the integer is negative, which zero never is.
+   */
+  bool negative;
+
+  /**
+   * The first digit which is not a leading zero.
+   */
+  It digits;
+};
+
+/**
+ * Splits a word which is an integer, an optional sign followed by decimal
+ * digits, or returns none if it is not one. The digits of contiguous words
+ * are validated and skipped with vector instructions.
+ */
+template <char_iterator It>
+constexpr std::optional<integer_parts<It>>
+parse_integer (It first, It last)
+{
+  bool negative = false;
+  if (first != last && (*first == '+' || *first == '-'))
+    {
+      negative = *first == '-';
+      ++first;
+    }
+  if (first == last)
+    return std::nullopt;
+
+  if constexpr (std::contiguous_iterator<It>)
+    if (!std::is_constant_evaluated ())
+      {
+        auto *data = std::to_address (first);
+        auto size = static_cast<std::size_t> (last - first);
+        if (digit_prefix (data, size) != size)
+          return std::nullopt;
+        first += static_cast<std::iter_difference_t<It>> (
+            char_prefix (data, size, '0'));
+        return integer_parts<It>{negative && first != last, first};
+      }
+
+  for (auto it = first; it != last; ++it)
+    if (*it < '0' || *it > '9')
+      return std::nullopt;
+  while (first != last && *first == '0')
+    ++first;
+  return integer_parts<It>{negative && first != last, first};
+}
+
+/**
+ * Character of a word as compared by a policy.
+ */
+template <typename Policy>
+constexpr char
+word_char (char ch) noexcept
+{
+  if constexpr (Policy::case_insensitive)
+    return lower_case_table[static_cast<unsigned char> (ch)];
+  else
+    return ch;
+}
 }
 
 /**
@@ -81,12 +547,12 @@ template <detail::char_iterator It> struct token
    * Compares two tokens.
    *
    * Two tokens are equal if their types are the same. Furthermore, word tokens
-   * need to be equal (other tokens need not).
+   * need to be equal as by the policy (other tokens need not).
    *
    * @param lhs first token
    * @param rhs second token
    */
-  template <detail::char_iterator It2>
+  template <typename Policy = default_policy, detail::char_iterator It2>
   constexpr std::optional<std::optional<std::pair<It, It2>>>
   compare (const token<It2> &other)
   {
@@ -94,8 +560,47 @@ template <detail::char_iterator It> struct token
       return std::optional<std::pair<It, It2>>{std::nullopt};
     else if (type == token_type::word)
       {
-        auto [mismatch, mismatch_other]
-            = std::ranges::mismatch (first, last, other.first, other.last);
+        // The digits of integers are compared like words.
+        if constexpr (Policy::integer_values)
+          if (auto value = detail::parse_integer (first, last))
+            if (auto other_value
+                = detail::parse_integer (other.first, other.last))
+              {
+                if (value->negative != other_value->negative)
+                  return {{{first, other.first}}};
+
+                token digits{type, value->digits, last};
+                oicompare::token<It2> other_digits{type, other_value->digits,
+                                                   other.last};
+                return digits.template compare<default_policy> (
+                    other_digits);
+              }
+
+        if constexpr (std::contiguous_iterator<It>
+                      && std::contiguous_iterator<It2>
+                      && !Policy::case_insensitive)
+          if (!std::is_constant_evaluated ())
+            {
+              using difference = std::iter_difference_t<It>;
+              using other_difference = std::iter_difference_t<It2>;
+
+              auto size = static_cast<std::size_t> (last - first);
+              auto other_size
+                  = static_cast<std::size_t> (other.last - other.first);
+              auto same = detail::common_prefix (
+                  std::to_address (first), std::to_address (other.first),
+                  std::min (size, other_size));
+              if (same == size && same == other_size)
+                return std::nullopt;
+              else
+                return {{{first + static_cast<difference> (same),
+                          other.first
+                              + static_cast<other_difference> (same)}}};
+            }
+
+        auto [mismatch, mismatch_other] = std::ranges::mismatch (
+            first, last, other.first, other.last, {},
+            detail::word_char<Policy>, detail::word_char<Policy>);
         if (mismatch == last && mismatch_other == other.last)
           return std::nullopt;
         else
@@ -108,18 +613,30 @@ template <detail::char_iterator It> struct token
 
 namespace detail
 {
-template <detail::char_iterator It, std::sentinel_for<It> Sent>
+/**
+ * Scans a token of a policy. Under a strict_trailing_whitespace policy,
+ * whitespace followed by a newline or the end of the input is a word token.
+ */
+template <typename Policy = default_policy, detail::char_iterator It,
+          std::sentinel_for<It> Sent>
 constexpr token<It>
 scan (It &first, Sent last)
 {
   using token = token<It>;
 
-  while (first != last && is_whitespace (*first))
+  auto whitespace = first;
+  while (first != last
+         && classify<Policy> (*first) == char_class::whitespace)
     ++first;
 
+  if constexpr (Policy::strict_trailing_whitespace)
+    if (first != whitespace
+        && (first == last || classify<Policy> (*first) == char_class::newline))
+      return token{token_type::word, whitespace, first};
+
   if (first == last)
     return token{token_type::eof, first, first};
-  else if (*first == '\n')
+  else if (classify<Policy> (*first) == char_class::newline)
     {
       auto first_save = first;
       ++first;
@@ -128,11 +645,228 @@ scan (It &first, Sent last)
   else
     {
       auto first_save = first;
-      while (first != last && !is_whitespace (*first) && *first != '\n')
+      while (first != last && classify<Policy> (*first) == char_class::word)
         ++first;
       return token{token_type::word, first_save, first};
     }
 }
+
+/**
+ * Scans tokens using detail::scan.
+ */
+template <detail::char_iterator It, std::sentinel_for<It> Sent,
+          typename Policy = default_policy>
+struct generic_scanner
+{
+  It first;
+  Sent last;
+
+  constexpr token<It>
+  next ()
+  {
+    return scan<Policy> (first, last);
+  }
+};
+
+/**
+ * Scans tokens of a contiguous input.
+ *
+ * The input is classified in blocks of 64 characters into whitespace and
+ * newline bit masks, using vector instructions where available, so that
+ * finding a token boundary is a count of trailing zeros.
+ */
+template <typename Policy = default_policy> class block_scanner
+{
+public:
+  static_assert (same_char_classes (
+                     Policy::classes,
+                     make_char_classes (newline_is_whitespace<Policy>)),
+                 "Vector classification only supports the standard "
+                 "whitespace characters");
+
+  static constexpr std::size_t block_size = 64;
+
+  block_scanner (const char *first, const char *last) noexcept
+      : ptr_{first}, last_{last}, base_{first}
+  {
+    classify ();
+  }
+
+  token<const char *>
+  next () noexcept
+  {
+    auto *whitespace = ptr_;
+    ptr_ = find<false> ();
+
+    if constexpr (Policy::strict_trailing_whitespace)
+      if (ptr_ != whitespace
+          && (ptr_ == last_ || newline_ >> (ptr_ - base_) & 1))
+        return {token_type::word, whitespace, ptr_};
+
+    if (ptr_ == last_)
+      return {token_type::eof, ptr_, ptr_};
+    else if (newline_ >> (ptr_ - base_) & 1)
+      {
+        ++ptr_;
+        return {token_type::newline, ptr_ - 1, ptr_};
+      }
+    else
+      {
+        auto first = ptr_;
+        ptr_ = find<true> ();
+        return {token_type::word, first, ptr_};
+      }
+  }
+
+  /**
+   * The position of the next character to scan.
+   */
+  const char *
+  position () const noexcept
+  {
+    return ptr_;
+  }
+
+  /**
+   * Skips the rest of the input, so that the next token is its end.
+   */
+  void
+  skip_to_end () noexcept
+  {
+    ptr_ = base_ = last_;
+    classify ();
+  }
+
+private:
+  /**
+   * Finds the first token boundary (if Boundary) or the first non-whitespace
+   * character (otherwise) at or after ptr_, or last_ if there is none.
+   *
+   * Bits past the end of the input are set in whitespace_, so that they are
+   * never found as a start of a token and are always found as an end.
+   */
+  template <bool Boundary>
+  const char *
+  find () noexcept
+  {
+    while (true)
+      {
+        std::size_t offset = ptr_ - base_;
+        if (offset < block_size)
+          {
+            auto mask = Boundary ? whitespace_ | newline_ : ~whitespace_;
+            if (auto masked = mask & (~std::uint64_t{0} << offset))
+              return base_ + std::countr_zero (masked);
+          }
+
+        if (static_cast<std::size_t> (last_ - base_) <= block_size)
+          return last_;
+
+        base_ += block_size;
+        ptr_ = base_;
+        classify ();
+      }
+  }
+
+  void
+  classify () noexcept
+  {
+    std::size_t size = last_ - base_;
+
+    if (size >= block_size)
+      {
+        whitespace_ = newline_ = 0;
+        if constexpr (simd::available)
+          for (std::size_t i = 0; i < block_size; i += simd::width)
+            {
+              auto chunk = simd::vector::load (base_ + i);
+              std::uint64_t whitespace = whitespace_bytes (chunk).bits ();
+              std::uint64_t newline = chunk.eq ('\n').bits ();
+              if constexpr (newline_is_whitespace<Policy>)
+                whitespace_ |= (whitespace | newline) << i;
+              else
+                {
+                  whitespace_ |= whitespace << i;
+                  newline_ |= newline << i;
+                }
+            }
+        else
+          classify_scalar (block_size);
+      }
+    else
+      {
+        whitespace_ = ~std::uint64_t{0} << size;
+        newline_ = 0;
+        classify_scalar (size);
+      }
+  }
+
+  void
+  classify_scalar (std::size_t size) noexcept
+  {
+    for (std::size_t i = 0; i < size; ++i)
+      {
+        auto type = detail::classify<Policy> (base_[i]);
+        whitespace_ |= std::uint64_t{type == char_class::whitespace} << i;
+        newline_ |= std::uint64_t{type == char_class::newline} << i;
+      }
+  }
+
+  const char *ptr_;
+  const char *last_;
+  const char *base_;
+  std::uint64_t whitespace_;
+  std::uint64_t newline_;
+};
+
+/**
+ * Scans tokens of a contiguous input using block_scanner.
+ */
+template <detail::char_iterator It, typename Policy = default_policy>
+class contiguous_scanner
+{
+public:
+  /**
+   * @param tail the beginning of the trailing whitespace of the input, as
+   *             found by trailing_whitespace(), or null to find it when needed
+   */
+  template <typename Sent>
+  contiguous_scanner (It first, Sent last,
+                      const char *tail = nullptr) noexcept
+      : first_{first}, data_{std::to_address (first)},
+        last_{data_ + (last - first)}, tail_{tail}, scanner_{data_, last_}
+  {
+  }
+
+  token<It>
+  next () noexcept
+  {
+    auto token = scanner_.next ();
+    return {token.type, first_ + (token.first - data_),
+            first_ + (token.last - data_)};
+  }
+
+  /**
+   * Skips the rest of the input if it is only whitespace and newlines, so
+   * that the next token is its end. Where they begin is found by scanning
+   * the input backwards, only the first time.
+   */
+  void
+  skip_trailing_whitespace () noexcept
+  {
+    if (!tail_)
+      tail_ = trailing_whitespace (scanner_.position (), last_);
+    if (scanner_.position () >= tail_)
+      scanner_.skip_to_end ();
+  }
+
+private:
+  It first_;
+  const char *data_;
+  const char *last_;
+  const char *tail_;
+  block_scanner<Policy> scanner_;
+};
 }
 
 /**
@@ -159,39 +893,306 @@ template <detail::char_iterator It1, detail::char_iterator It2> struct mismatch
    * The token found in the second file.
    */
   token<It2> second;
+
+  /**
+   * The difference of the numbers (the second minus the first), if the tokens
+   * are numbers compared with a tolerance.
+   */
+  std::optional<double> numeric_difference = std::nullopt;
+
+  /**
+   * The byte offsets of the tokens in the inputs, where they are known. Only
+   * the comparisons of files in io.hh find them.
+   */
+  std::pair<std::optional<std::size_t>, std::optional<std::size_t>> offsets
+      = {};
 };
 
 /**
- * Compare two input ranges, returning the mismatch or none if they are
- * equivalent.
+ * Tolerance of comparing numbers. Words which are both numbers are equal if
+ * their difference is at most the absolute tolerance, or at most the relative
+ * tolerance times the magnitude of the first (expected) number.
+ */
+struct tolerance
+{
+  double absolute = 0;
+  double relative = 0;
+
+  /**
+   * Whether the received number is close enough to the expected one.
+   */
+  bool
+  accepts (double expected, double received) const noexcept
+  {
+    auto difference = std::abs (received - expected);
+    return difference <= absolute
+           || difference <= relative * std::abs (expected);
+  }
+};
+
+/**
+ * A hook told about the work done by compare(): every token compared and
+ * every byte of the common prefix skipped without tokenizing it. The input of
+ * a token is 0 for the first one and 1 for the second one.
+ */
+template <typename Counters>
+concept counters_hook
+    = requires (Counters &counters, std::size_t value, token_type type) {
+        counters.token (value, type);
+        counters.skip (value);
+      };
+
+/**
+ * Counts the tokens compared by compare(), besides the end of input, and the
+ * size of the common prefix of contiguous inputs, which is not tokenized.
+ */
+struct counters
+{
+  std::size_t skipped = 0;
+  std::array<std::size_t, 2> tokens{};
+  std::array<std::size_t, 2> newlines{};
+
+  constexpr void
+  token (std::size_t input, token_type type) noexcept
+  {
+    tokens[input] += type != token_type::eof;
+    newlines[input] += type == token_type::newline;
+  }
+
+  constexpr void
+  skip (std::size_t bytes) noexcept
+  {
+    skipped += bytes;
+  }
+
+  constexpr counters &
+  operator+= (const counters &other) noexcept
+  {
+    skipped += other.skipped;
+    for (std::size_t input = 0; input < 2; ++input)
+      {
+        tokens[input] += other.tokens[input];
+        newlines[input] += other.newlines[input];
+      }
+    return *this;
+  }
+};
+
+/**
+ * A hook which counts nothing, compiled away entirely. It is used when no
+ * hook is given.
+ */
+struct no_counters
+{
+  constexpr void
+  token (std::size_t, token_type) noexcept
+  {
+  }
+
+  constexpr void
+  skip (std::size_t) noexcept
+  {
+  }
+};
+
+namespace detail
+{
+/**
+ * Whether all the characters could be a part of a decimal number.
+ */
+inline bool
+number_characters (const char *first, const char *last) noexcept
+{
+  auto is_number_character = [] (char ch) {
+    return (ch >= '0' && ch <= '9') || ch == '.' || ch == '-' || ch == '+'
+           || ch == 'e' || ch == 'E';
+  };
+
+  if constexpr (simd::available)
+    {
+      constexpr auto all = static_cast<simd::mask> (
+          (std::uint64_t{1} << simd::width) - 1);
+      for (; static_cast<std::size_t> (last - first) >= simd::width;
+           first += simd::width)
+        {
+          auto chunk = simd::vector::load (first);
+          auto valid = chunk.between ('0', '9') | chunk.eq ('.')
+                       | chunk.eq ('-') | chunk.eq ('+') | chunk.eq ('e')
+                       | chunk.eq ('E');
+          if (valid.bits () != all)
+            return false;
+        }
+    }
+
+  return std::all_of (first, last, is_number_character);
+}
+
+/**
+ * Parses a word which is a finite decimal number.
+ */
+inline std::optional<double>
+parse_number (const char *first, const char *last) noexcept
+{
+  if (first != last && *first == '+' && last - first > 1 && first[1] != '-')
+    ++first;
+  if (first == last || !number_characters (first, last))
+    return std::nullopt;
+
+  double value;
+#ifdef __cpp_lib_to_chars
+  auto [ptr, ec] = std::from_chars (first, last, value);
+  if (ec != std::errc{} || ptr != last)
+    return std::nullopt;
+#else
+  char buffer[64];
+  if (static_cast<std::size_t> (last - first) >= sizeof (buffer))
+    return std::nullopt;
+  *std::copy (first, last, buffer) = '\0';
+  char *end;
+  errno = 0;
+  value = std::strtod (buffer, &end);
+  if (errno != 0 || end != buffer + (last - first))
+    return std::nullopt;
+#endif
+  return value;
+}
+
+/**
+ * Parses a word token which is a finite decimal number.
+ */
+template <detail::char_iterator It>
+std::optional<double>
+parse_number (const token<It> &token)
+{
+  if constexpr (std::contiguous_iterator<It>)
+    return parse_number (std::to_address (token.first),
+                         std::to_address (token.last));
+  else
+    {
+      std::string word (token.first, token.last);
+      return parse_number (word.data (), word.data () + word.size ());
+    }
+}
+
+/**
+ * Compares two different word tokens as numbers. Returns whether they are
+ * accepted, along with their difference if they are numbers.
+ */
+template <detail::char_iterator It1, detail::char_iterator It2>
+std::pair<bool, std::optional<double>>
+compare_numbers (const tolerance &tolerance, const token<It1> &tok1,
+                 const token<It2> &tok2)
+{
+  if (tok1.type != token_type::word || tok2.type != token_type::word)
+    return {false, std::nullopt};
+
+  auto number1 = parse_number (tok1);
+  auto number2 = number1 ? parse_number (tok2) : std::nullopt;
+  if (!number2)
+    return {false, std::nullopt};
+
+  return {tolerance.accepts (*number1, *number2), *number2 - *number1};
+}
+
+/**
+ * Skips the rest of the input of a scanner if it is blank, where the scanner
+ * can find that without tokenizing it.
+ */
+template <typename Scanner>
+constexpr void
+skip_trailing_whitespace (Scanner &scanner) noexcept
+{
+  if constexpr (requires { scanner.skip_trailing_whitespace (); })
+    scanner.skip_trailing_whitespace ();
+}
+
+/**
+ * Compares the tokens produced by two scanners with a policy, comparing
+ * numbers with the tolerance if it is not null, and telling the counters
+ * about every token.
  *
- * @param first1 first input begin
- * @param last1 first input end
- * @param first2 last input begin
- * @param last2 last input end
- * @return mismatch or none
+ * Under a policy where newlines are whitespace, the line number is not
+ * counted, the caller finds it.
  */
-template <detail::char_iterator It1, std::sentinel_for<It1> Sent1,
-          detail::char_iterator It2, std::sentinel_for<It2> Sent2>
+template <detail::char_iterator It1, detail::char_iterator It2,
+          typename Policy = default_policy, typename Scanner1,
+          typename Scanner2, counters_hook Counters>
 constexpr std::optional<mismatch<It1, It2>>
-compare (It1 first1, Sent1 last1, It2 first2, Sent2 last2)
+compare_tokens (Scanner1 &scanner1, Scanner2 &scanner2,
+                const tolerance *tolerance, Counters &counters)
 {
   std::make_unsigned_t<std::iter_difference_t<It1>> line_number = 1;
+  // Whether the previous tokens were newlines, or there were none.
+  [[maybe_unused]] bool line_start1 = true, line_start2 = true;
+
+  auto next1 = [&] {
+    auto tok = scanner1.next ();
+    counters.token (0, tok.type);
+    return tok;
+  };
+  auto next2 = [&] {
+    auto tok = scanner2.next ();
+    counters.token (1, tok.type);
+    return tok;
+  };
 
   while (true)
     {
-      auto tok1 = detail::scan (first1, last1);
-      auto tok2 = detail::scan (first2, last2);
-
-      if (tok1.type == token_type::eof)
-        while (tok2.type == token_type::newline)
-          tok2 = detail::scan (first2, last2);
-      else if (tok2.type == token_type::eof)
-        while (tok1.type == token_type::newline)
-          tok1 = detail::scan (first1, last1);
-
-      if (auto mismatch = tok1.compare (tok2))
-        return {{line_number, std::move (*mismatch), tok1, tok2}};
+      auto tok1 = next1 ();
+      auto tok2 = next2 ();
+
+      // Once an input has ended, the rest of the other one is skipped if it
+      // is blank, rather than tokenized.
+      if constexpr (Policy::ignore_blank_lines)
+        {
+          for (; line_start1 && tok1.type == token_type::newline;
+               tok1 = next1 ())
+            {
+              ++line_number;
+              if (tok2.type == token_type::eof)
+                skip_trailing_whitespace (scanner1);
+            }
+          while (line_start2 && tok2.type == token_type::newline)
+            {
+              if (tok1.type == token_type::eof)
+                skip_trailing_whitespace (scanner2);
+              tok2 = next2 ();
+            }
+          line_start1 = tok1.type == token_type::newline;
+          line_start2 = tok2.type == token_type::newline;
+        }
+
+      if constexpr (!Policy::strict_trailing_whitespace)
+        {
+          if (tok1.type == token_type::eof)
+            while (tok2.type == token_type::newline)
+              {
+                skip_trailing_whitespace (scanner2);
+                tok2 = next2 ();
+              }
+          else if (tok2.type == token_type::eof)
+            while (tok1.type == token_type::newline)
+              {
+                skip_trailing_whitespace (scanner1);
+                tok1 = next1 ();
+              }
+        }
+
+      if (auto mismatch = tok1.template compare<Policy> (tok2))
+        {
+          std::optional<double> difference;
+          if (tolerance)
+            {
+              bool accepted;
+              std::tie (accepted, difference)
+                  = compare_numbers (*tolerance, tok1, tok2);
+              if (accepted)
+                continue;
+            }
+
+          return {{line_number, std::move (*mismatch), tok1, tok2,
+                   difference}};
+        }
       else if (tok1.type == token_type::newline)
         ++line_number;
       else if (tok1.type == token_type::eof)
@@ -201,6 +1202,303 @@ compare (It1 first1, Sent1 last1, It2 first2, Sent2 last2)
   return {};
 }
 
+/**
+ * Finds where to resume tokenizing both inputs after their common prefix,
+ * such that the tokens are the same as if the whole inputs were tokenized.
+ */
+template <typename Policy>
+const char *
+find_resume_point (const char *first, const char *prefix_last) noexcept
+{
+  auto *boundary = find_last_boundary (first, prefix_last);
+
+  // Whether a newline is skipped or whitespace is a token depends on what is
+  // before it, so resume at the last word, or at the beginning of the line.
+  if constexpr (Policy::ignore_blank_lines
+                || Policy::strict_trailing_whitespace)
+    {
+      while (boundary != first && is_whitespace (boundary[-1]))
+        --boundary;
+      boundary = find_last_boundary (first, boundary);
+    }
+
+  return boundary;
+}
+
+/**
+ * Compares two contiguous inputs, skipping their common prefix. The
+ * beginnings of their trailing whitespace may be given, if they are known.
+ */
+template <typename Policy, detail::char_iterator It1, typename Sent1,
+          detail::char_iterator It2, typename Sent2, counters_hook Counters>
+std::optional<mismatch<It1, It2>>
+compare_contiguous (It1 first1, Sent1 last1, It2 first2, Sent2 last2,
+                    const tolerance *tolerance, Counters &counters,
+                    const char *tail1 = nullptr, const char *tail2 = nullptr)
+{
+  const char *data1 = std::to_address (first1);
+  const char *data2 = std::to_address (first2);
+  std::size_t size1 = last1 - first1;
+  std::size_t size2 = last2 - first2;
+
+  // Most inputs are identical, so skip their common prefix without
+  // tokenizing it, up to the beginning of the token it ends in.
+  auto prefix = common_prefix (data1, data2, std::min (size1, size2));
+  if (prefix == size1 && prefix == size2)
+    return std::nullopt;
+  prefix = find_resume_point<Policy> (data1, data1 + prefix) - data1;
+  counters.skip (prefix);
+
+  contiguous_scanner<It1, Policy> scanner1{
+      first1 + static_cast<std::iter_difference_t<It1>> (prefix), last1,
+      tail1};
+  contiguous_scanner<It2, Policy> scanner2{
+      first2 + static_cast<std::iter_difference_t<It2>> (prefix), last2,
+      tail2};
+  auto result = compare_tokens<It1, It2, Policy> (scanner1, scanner2,
+                                                  tolerance, counters);
+
+  // Lines of the prefix are only counted when a mismatch is reported.
+  if (result)
+    {
+      if constexpr (newline_is_whitespace<Policy>)
+        result->line_number
+            += count_newlines (data1, std::to_address (result->first.first));
+      else
+        result->line_number += count_newlines (data1, data1 + prefix);
+    }
+
+  return result;
+}
+}
+
+namespace detail
+{
+/**
+ * Compares two input ranges with a policy, comparing numbers with the
+ * tolerance if it is not null, and telling the counters about the work done.
+ */
+template <typename Policy, detail::char_iterator It1,
+          std::sentinel_for<It1> Sent1, detail::char_iterator It2,
+          std::sentinel_for<It2> Sent2, counters_hook Counters>
+constexpr std::optional<mismatch<It1, It2>>
+compare (It1 first1, Sent1 last1, It2 first2, Sent2 last2,
+         const tolerance *tolerance, Counters &counters)
+{
+  if constexpr (detail::contiguous_char_input<It1, Sent1>
+                && detail::contiguous_char_input<It2, Sent2>)
+    if (!std::is_constant_evaluated ())
+      return detail::compare_contiguous<Policy> (first1, last1, first2, last2,
+                                                 tolerance, counters);
+
+  detail::generic_scanner<It1, Sent1, Policy> scanner1{first1, last1};
+  detail::generic_scanner<It2, Sent2, Policy> scanner2{first2, last2};
+  auto result = detail::compare_tokens<It1, It2, Policy> (
+      scanner1, scanner2, tolerance, counters);
+
+  if constexpr (newline_is_whitespace<Policy>)
+    if (result)
+      for (; first1 != result->first.first; ++first1)
+        result->line_number += *first1 == '\n';
+
+  return result;
+}
+
+/**
+ * Finds the beginning of the line after the one with a token, or last.
+ */
+inline const char *
+next_line (const token<const char *> &token, const char *last) noexcept
+{
+  if (token.type == token_type::newline)
+    return token.last;
+  auto *newline = static_cast<const char *> (
+      std::memchr (token.first, '\n', last - token.first));
+  return newline ? newline + 1 : last;
+}
+
+/**
+ * Compares two contiguous inputs with a policy, going on after every
+ * mismatch at the next line of both, as described for compare_all().
+ */
+template <typename Policy, counters_hook Counters>
+std::size_t
+compare_all (const char *first1, const char *last1, const char *first2,
+             const char *last2, const tolerance *tolerance,
+             std::size_t max_mismatches,
+             std::vector<mismatch<const char *, const char *>> &mismatches,
+             Counters &counters)
+{
+  std::size_t lines = 0;
+  // The number of lines before the ones being compared.
+  std::size_t line_number = 0;
+  // The trailing whitespace is found once rather than by every comparison.
+  auto *tail1 = trailing_whitespace (first1, last1);
+  auto *tail2 = trailing_whitespace (first2, last2);
+  while (auto result = compare_contiguous<Policy> (
+             first1, last1, first2, last2, tolerance, counters, tail1, tail2))
+    {
+      ++lines;
+      result->line_number += line_number;
+      line_number = result->line_number;
+      first1 = next_line (result->first, last1);
+      first2 = next_line (result->second, last2);
+      if (mismatches.size () < max_mismatches)
+        mismatches.push_back (*result);
+    }
+  return lines;
+}
+}
+
+/**
+ * Compares two contiguous inputs, going on after every mismatch at the
+ * beginning of the next line of both, and returns the number of mismatched
+ * lines. Each part between the mismatches is compared as by compare(), so
+ * every line of the first input at which the inputs stop matching counts
+ * once, and the lines with words in the rest of the longer input count as
+ * mismatched with the end of the shorter one.
+ *
+ * @param first1 first input begin
+ * @param last1 first input end
+ * @param first2 last input begin
+ * @param last2 last input end
+ * @param max_mismatches number of the first mismatches to keep
+ * @param mismatches vector to which the first mismatches are appended
+ * @return number of mismatched lines
+ */
+template <typename Policy = default_policy>
+std::size_t
+compare_all (const char *first1, const char *last1, const char *first2,
+             const char *last2, std::size_t max_mismatches,
+             std::vector<mismatch<const char *, const char *>> &mismatches)
+{
+  no_counters counters;
+  return detail::compare_all<Policy> (first1, last1, first2, last2, nullptr,
+                                      max_mismatches, mismatches, counters);
+}
+
+/**
+ * Compares two contiguous inputs after every mismatch, comparing words which
+ * are numbers with a tolerance.
+ *
+ * @param first1 first input begin
+ * @param last1 first input end
+ * @param first2 last input begin
+ * @param last2 last input end
+ * @param tolerance tolerance of numbers
+ * @param max_mismatches number of the first mismatches to keep
+ * @param mismatches vector to which the first mismatches are appended
+ * @return number of mismatched lines
+ */
+template <typename Policy = default_policy>
+std::size_t
+compare_all (const char *first1, const char *last1, const char *first2,
+             const char *last2, const tolerance &tolerance,
+             std::size_t max_mismatches,
+             std::vector<mismatch<const char *, const char *>> &mismatches)
+{
+  no_counters counters;
+  return detail::compare_all<Policy> (first1, last1, first2, last2,
+                                      &tolerance, max_mismatches, mismatches,
+                                      counters);
+}
+
+/**
+ * Compare two input ranges, returning the mismatch or none if they are
+ * equivalent.
+ *
+ * The comparison rules are given by the policy, for example
+ * compare<ignore_whitespace_policy> (first, second).
+ *
+ * @param first1 first input begin
+ * @param last1 first input end
+ * @param first2 last input begin
+ * @param last2 last input end
+ * @return mismatch or none
+ */
+template <typename Policy = default_policy, detail::char_iterator It1,
+          std::sentinel_for<It1> Sent1, detail::char_iterator It2,
+          std::sentinel_for<It2> Sent2>
+constexpr std::optional<mismatch<It1, It2>>
+compare (It1 first1, Sent1 last1, It2 first2, Sent2 last2)
+{
+  no_counters counters;
+  return detail::compare<Policy> (std::move (first1), std::move (last1),
+                                  std::move (first2), std::move (last2),
+                                  nullptr, counters);
+}
+
+/**
+ * Compare two input ranges, telling a hook about the work done, for example
+ * counting the tokens with counters.
+ *
+ * @param first1 first input begin
+ * @param last1 first input end
+ * @param first2 last input begin
+ * @param last2 last input end
+ * @param counters hook told about every token compared
+ * @return mismatch or none
+ */
+template <typename Policy = default_policy, detail::char_iterator It1,
+          std::sentinel_for<It1> Sent1, detail::char_iterator It2,
+          std::sentinel_for<It2> Sent2, counters_hook Counters>
+constexpr std::optional<mismatch<It1, It2>>
+compare (It1 first1, Sent1 last1, It2 first2, Sent2 last2,
+         Counters &counters)
+{
+  return detail::compare<Policy> (std::move (first1), std::move (last1),
+                                  std::move (first2), std::move (last2),
+                                  nullptr, counters);
+}
+
+/**
+ * Compare two input ranges, comparing words which are numbers with a
+ * tolerance.
+ *
+ * @param first1 first input begin
+ * @param last1 first input end
+ * @param first2 last input begin
+ * @param last2 last input end
+ * @param tolerance tolerance of numbers
+ * @return mismatch or none
+ */
+template <typename Policy = default_policy, detail::char_iterator It1,
+          std::sentinel_for<It1> Sent1, detail::char_iterator It2,
+          std::sentinel_for<It2> Sent2>
+std::optional<mismatch<It1, It2>>
+compare (It1 first1, Sent1 last1, It2 first2, Sent2 last2,
+         const tolerance &tolerance)
+{
+  no_counters counters;
+  return detail::compare<Policy> (std::move (first1), std::move (last1),
+                                  std::move (first2), std::move (last2),
+                                  &tolerance, counters);
+}
+
+/**
+ * Compare two input ranges, comparing words which are numbers with a
+ * tolerance and telling a hook about the work done.
+ *
+ * @param first1 first input begin
+ * @param last1 first input end
+ * @param first2 last input begin
+ * @param last2 last input end
+ * @param tolerance tolerance of numbers
+ * @param counters hook told about every token compared
+ * @return mismatch or none
+ */
+template <typename Policy = default_policy, detail::char_iterator It1,
+          std::sentinel_for<It1> Sent1, detail::char_iterator It2,
+          std::sentinel_for<It2> Sent2, counters_hook Counters>
+std::optional<mismatch<It1, It2>>
+compare (It1 first1, Sent1 last1, It2 first2, Sent2 last2,
+         const tolerance &tolerance, Counters &counters)
+{
+  return detail::compare<Policy> (std::move (first1), std::move (last1),
+                                  std::move (first2), std::move (last2),
+                                  &tolerance, counters);
+}
+
 /**
  * Compare two input ranges, returning the mismatch or none if they are
  * equivalent.
@@ -209,13 +1507,35 @@ compare (It1 first1, Sent1 last1, It2 first2, Sent2 last2)
  * @param range2 last range
  * @return mismatch or none
  */
-template <detail::char_range R1, detail::char_range R2>
+template <typename Policy = default_policy, detail::char_range R1,
+          detail::char_range R2>
 constexpr std::optional<
     mismatch<std::ranges::iterator_t<R1>, std::ranges::iterator_t<R2>>>
 compare (R1 &&range1, R2 &&range2)
 {
-  return compare (std::ranges::begin (range1), std::ranges::end (range1),
-                  std::ranges::begin (range2), std::ranges::end (range2));
+  return compare<Policy> (
+      std::ranges::begin (range1), std::ranges::end (range1),
+      std::ranges::begin (range2), std::ranges::end (range2));
+}
+
+/**
+ * Compare two input ranges, comparing words which are numbers with a
+ * tolerance.
+ *
+ * @param range1 first range
+ * @param range2 last range
+ * @param tolerance tolerance of numbers
+ * @return mismatch or none
+ */
+template <typename Policy = default_policy, detail::char_range R1,
+          detail::char_range R2>
+std::optional<
+    mismatch<std::ranges::iterator_t<R1>, std::ranges::iterator_t<R2>>>
+compare (R1 &&range1, R2 &&range2, const tolerance &tolerance)
+{
+  return compare<Policy> (
+      std::ranges::begin (range1), std::ranges::end (range1),
+      std::ranges::begin (range2), std::ranges::end (range2), tolerance);
 }
 }
 
@@ -0,0 +1,373 @@
+#ifndef __OICOMPARE_PARALLEL_HH__
+#define __OICOMPARE_PARALLEL_HH__
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <optional>
+#include <ranges>
+#include <vector>
+
+#include "oicompare.hh"
+#include "thread_pool.hh"
+
+namespace oicompare
+{
+/**
+ * Default number of bytes processed by one task of compare_parallel.
+ */
+constexpr std::size_t default_parallel_block_size = std::size_t{1} << 20;
+
+namespace detail
+{
+/**
+ * The index of the first block which found something, so that later blocks
+ * may be skipped.
+ */
+class first_block
+{
+public:
+  bool
+  skip (std::size_t block) const noexcept
+  {
+    return block > index_.load (std::memory_order_relaxed);
+  }
+
+  void
+  found (std::size_t block) noexcept
+  {
+    auto index = index_.load (std::memory_order_relaxed);
+    while (block < index
+           && !index_.compare_exchange_weak (index, block,
+                                             std::memory_order_relaxed))
+      ;
+  }
+
+  std::size_t
+  get () const noexcept
+  {
+    return index_.load (std::memory_order_relaxed);
+  }
+
+private:
+  std::atomic<std::size_t> index_ = std::numeric_limits<std::size_t>::max ();
+};
+
+/**
+ * Returns the length of the common prefix of two arrays, comparing blocks in
+ * parallel.
+ */
+inline std::size_t
+parallel_common_prefix (const char *first1, const char *first2,
+                        std::size_t size, thread_pool &pool,
+                        std::size_t block_size)
+{
+  std::size_t blocks = (size + block_size - 1) / block_size;
+  std::vector<std::size_t> prefixes (blocks);
+  first_block differing;
+
+  {
+    task_group group{pool};
+    for (std::size_t i = 0; i < blocks; ++i)
+      group.submit ([=, &prefixes, &differing] {
+        if (differing.skip (i))
+          return;
+
+        auto offset = i * block_size;
+        auto length = std::min (block_size, size - offset);
+        prefixes[i]
+            = common_prefix (first1 + offset, first2 + offset, length);
+        if (prefixes[i] < length)
+          differing.found (i);
+      });
+  }
+
+  if (auto i = differing.get (); i < blocks)
+    return i * block_size + prefixes[i];
+  else
+    return size;
+}
+
+/**
+ * Counts the newlines of a range in blocks, in parallel. Returns the prefix
+ * sums of the counts, with element i being the number of newlines in the
+ * blocks before block i.
+ */
+inline std::vector<std::size_t>
+parallel_newline_sums (const char *first, const char *last, thread_pool &pool,
+                       std::size_t block_size)
+{
+  std::size_t size = last - first;
+  std::size_t blocks = (size + block_size - 1) / block_size;
+  std::vector<std::size_t> sums (blocks + 1);
+
+  {
+    task_group group{pool};
+    for (std::size_t i = 0; i < blocks; ++i)
+      group.submit ([=, &sums] {
+        auto offset = i * block_size;
+        auto length = std::min (block_size, size - offset);
+        sums[i + 1] = count_newlines (first + offset, first + offset + length);
+      });
+  }
+
+  for (std::size_t i = 0; i < blocks; ++i)
+    sums[i + 1] += sums[i];
+  return sums;
+}
+
+/**
+ * Finds the position after the given number of newlines of a range, or null
+ * if it has fewer.
+ */
+inline const char *
+after_newlines (const char *first, const char *last,
+                std::size_t newlines) noexcept
+{
+  // Whole pieces before the last newline are only counted.
+  constexpr std::size_t piece_size = 4096;
+  while (static_cast<std::size_t> (last - first) > piece_size)
+    {
+      auto count = count_newlines (first, first + piece_size);
+      if (count >= newlines)
+        break;
+      newlines -= count;
+      first += piece_size;
+    }
+
+  for (; newlines > 0; --newlines)
+    {
+      auto *newline = static_cast<const char *> (
+          std::memchr (first, '\n', last - first));
+      if (!newline)
+        return nullptr;
+      first = newline + 1;
+    }
+  return first;
+}
+
+/**
+ * Compares two contiguous inputs on a thread pool, comparing numbers with the
+ * tolerance if it is not null. The work done by every task is added to the
+ * counters if they are not null.
+ */
+inline std::optional<mismatch<const char *, const char *>>
+compare_parallel (const char *first1, const char *last1, const char *first2,
+                  const char *last2, thread_pool &pool,
+                  const tolerance *tolerance, std::size_t block_size,
+                  counters *counters = nullptr)
+{
+  block_size = std::max (block_size, std::size_t{1});
+  std::size_t size1 = last1 - first1;
+  std::size_t size2 = last2 - first2;
+
+  // Skip the common prefix, up to the beginning of the token it ends in, as
+  // compare() does.
+  auto prefix = parallel_common_prefix (
+      first1, first2, std::min (size1, size2), pool, block_size);
+  if (prefix == size1 && prefix == size2)
+    return std::nullopt;
+  prefix = find_last_boundary (first1, first1 + prefix) - first1;
+  first1 += prefix;
+  first2 += prefix;
+
+  struct chunk
+  {
+    // Number of newlines of the first input before the chunk.
+    std::size_t line;
+    std::optional<mismatch<const char *, const char *>> result;
+    oicompare::counters counters;
+  };
+
+  // Chunks are appended while the earlier ones are compared, which leaves
+  // the elements of a deque in place.
+  std::deque<chunk> chunks;
+  first_block mismatched;
+
+  {
+    task_group group{pool};
+    auto *chunk1 = first1;
+    auto *chunk2 = first2;
+    std::size_t line = 0;
+
+    // Split the first input after its first newline at least a block into
+    // the chunk, unless it is the last character, and the second one after as
+    // many newlines, as long as it has them. Both
+    // chunks then hold the same lines, so the tokens of the inputs are equal
+    // if and only if the tokens of every pair of chunks are. The last chunks
+    // hold the rest of the inputs. No more chunks are split once one of them
+    // has a mismatch.
+    for (std::size_t i = 0; !mismatched.skip (i); ++i)
+      {
+        auto *end1 = last1;
+        auto *end2 = last2;
+        std::size_t newlines = 0;
+        if (static_cast<std::size_t> (last1 - chunk1) > block_size)
+          if (auto *newline = static_cast<const char *> (std::memchr (
+                  chunk1 + block_size - 1, '\n', last1 - chunk1 - block_size)))
+            {
+              newlines = count_newlines (chunk1, newline + 1);
+              if (auto *split2 = after_newlines (chunk2, last2, newlines))
+                {
+                  end1 = newline + 1;
+                  end2 = split2;
+                }
+            }
+
+        auto &current = chunks.emplace_back (line);
+        auto task = [=, &current, &mismatched] {
+          if (mismatched.skip (i))
+            return;
+
+          if (counters)
+            current.result = compare<default_policy> (
+                chunk1, end1, chunk2, end2, tolerance, current.counters);
+          else
+            {
+              no_counters none;
+              current.result = compare<default_policy> (
+                  chunk1, end1, chunk2, end2, tolerance, none);
+            }
+
+          if (current.result)
+            mismatched.found (i);
+        };
+
+        // The first chunk is compared right away, as a mismatch is often
+        // close to the beginning.
+        if (i == 0)
+          task ();
+        else
+          group.submit (task);
+
+        if (end1 == last1)
+          break;
+        chunk1 = end1;
+        chunk2 = end2;
+        line += newlines;
+      }
+  }
+
+  if (counters)
+    {
+      counters->skip (prefix);
+      for (const auto &chunk : chunks)
+        *counters += chunk.counters;
+    }
+
+  auto i = mismatched.get ();
+  if (i >= chunks.size ())
+    return std::nullopt;
+
+  // Line numbers are relative to the chunk, and only the newlines before it
+  // are counted.
+  auto &result = chunks[i].result;
+  auto prefix_sums
+      = parallel_newline_sums (first1 - prefix, first1, pool, block_size);
+  result->line_number += prefix_sums.back () + chunks[i].line;
+  return result;
+}
+}
+
+/**
+ * Compare two contiguous inputs on a thread pool, returning the mismatch or
+ * none if they are equivalent. The result is the same as that of compare().
+ *
+ * Both inputs are split at the same newlines into chunks, which are compared
+ * concurrently. The calling thread splits the chunks while the earlier ones
+ * are compared, and stops at a mismatch, so the inputs are read only up to
+ * the chunk with the first one. Lines are never split, so a single long line
+ * is compared by a single task. It must not be called from a task of the
+ * pool.
+ *
+ * @param first1 first input begin
+ * @param last1 first input end
+ * @param first2 last input begin
+ * @param last2 last input end
+ * @param pool thread pool running the tasks
+ * @param block_size approximate number of bytes processed by one task
+ * @return mismatch or none
+ */
+inline std::optional<mismatch<const char *, const char *>>
+compare_parallel (const char *first1, const char *last1, const char *first2,
+                  const char *last2, thread_pool &pool,
+                  std::size_t block_size = default_parallel_block_size)
+{
+  return detail::compare_parallel (first1, last1, first2, last2, pool,
+                                   nullptr, block_size);
+}
+
+/**
+ * Compare two contiguous inputs on a thread pool, comparing words which are
+ * numbers with a tolerance.
+ *
+ * @param first1 first input begin
+ * @param last1 first input end
+ * @param first2 last input begin
+ * @param last2 last input end
+ * @param pool thread pool running the tasks
+ * @param tolerance tolerance of numbers
+ * @param block_size approximate number of bytes processed by one task
+ * @return mismatch or none
+ */
+inline std::optional<mismatch<const char *, const char *>>
+compare_parallel (const char *first1, const char *last1, const char *first2,
+                  const char *last2, thread_pool &pool,
+                  const tolerance &tolerance,
+                  std::size_t block_size = default_parallel_block_size)
+{
+  return detail::compare_parallel (first1, last1, first2, last2, pool,
+                                   &tolerance, block_size);
+}
+
+/**
+ * Compare two contiguous ranges on a thread pool, returning the mismatch or
+ * none if they are equivalent.
+ *
+ * @param range1 first range
+ * @param range2 last range
+ * @param pool thread pool running the tasks
+ * @param block_size approximate number of bytes processed by one task
+ * @return mismatch or none
+ */
+template <std::ranges::contiguous_range R1, std::ranges::contiguous_range R2>
+std::optional<mismatch<const char *, const char *>>
+compare_parallel (R1 &&range1, R2 &&range2, thread_pool &pool,
+                  std::size_t block_size = default_parallel_block_size)
+{
+  auto *first1 = std::ranges::data (range1);
+  auto *first2 = std::ranges::data (range2);
+  return compare_parallel (first1, first1 + std::ranges::size (range1),
+                           first2, first2 + std::ranges::size (range2), pool,
+                           block_size);
+}
+
+/**
+ * Compare two contiguous ranges on a thread pool, comparing words which are
+ * numbers with a tolerance.
+ *
+ * @param range1 first range
+ * @param range2 last range
+ * @param pool thread pool running the tasks
+ * @param tolerance tolerance of numbers
+ * @param block_size approximate number of bytes processed by one task
+ * @return mismatch or none
+ */
+template <std::ranges::contiguous_range R1, std::ranges::contiguous_range R2>
+std::optional<mismatch<const char *, const char *>>
+compare_parallel (R1 &&range1, R2 &&range2, thread_pool &pool,
+                  const tolerance &tolerance,
+                  std::size_t block_size = default_parallel_block_size)
+{
+  auto *first1 = std::ranges::data (range1);
+  auto *first2 = std::ranges::data (range2);
+  return compare_parallel (first1, first1 + std::ranges::size (range1),
+                           first2, first2 + std::ranges::size (range2), pool,
+                           tolerance, block_size);
+}
+}
+
+#endif /* __OICOMPARE_PARALLEL_HH__ */
\ No newline at end of file
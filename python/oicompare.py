@@ -0,0 +1,107 @@
+"""Bindings of liboicompare, comparing outputs in the process.
+
+The library is loaded from the path in the OICOMPARE_LIBRARY environment
+variable, from the directory of this module, or from the search path of the
+dynamic linker. The comparisons run without the GIL held, as ctypes releases
+it around every call of a library loaded with CDLL.
+"""
+
+import ctypes
+import ctypes.util
+import os
+from typing import NamedTuple, Optional, Union
+
+_Path = Union[str, bytes, os.PathLike]
+
+__all__ = ['Result', 'compare_buffers', 'compare_files', 'version']
+
+
+class _Result(ctypes.Structure):
+    _fields_ = [
+        ('status', ctypes.c_int),
+        ('message', ctypes.POINTER(ctypes.c_char)),
+        ('message_size', ctypes.c_size_t),
+    ]
+
+
+def _load() -> ctypes.CDLL:
+    path = os.environ.get('OICOMPARE_LIBRARY')
+    if not path:
+        path = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                            'liboicompare.so')
+        if not os.path.exists(path):
+            path = ctypes.util.find_library('oicompare')
+    if not path:
+        raise ImportError('liboicompare.so not found')
+
+    library = ctypes.CDLL(path)
+    library.oicompare_version.argtypes = []
+    library.oicompare_version.restype = ctypes.c_char_p
+    library.oicompare_compare_files.argtypes = [
+        ctypes.c_char_p, ctypes.c_char_p, ctypes.c_char_p,
+        ctypes.POINTER(_Result)]
+    library.oicompare_compare_files.restype = ctypes.c_int
+    library.oicompare_compare_buffers.argtypes = [
+        ctypes.c_char_p, ctypes.c_size_t, ctypes.c_char_p, ctypes.c_size_t,
+        ctypes.c_char_p, ctypes.POINTER(_Result)]
+    library.oicompare_compare_buffers.restype = ctypes.c_int
+    library.oicompare_result_free.argtypes = [ctypes.POINTER(_Result)]
+    library.oicompare_result_free.restype = None
+    return library
+
+
+_library = _load()
+
+
+class Result(NamedTuple):
+    """Exit code of oicompare (0 if equivalent, 1 if not, 2 on an error) and
+    the message formatted by the translation."""
+
+    status: int
+    message: str
+
+    @property
+    def equivalent(self) -> bool:
+        return self.status == 0
+
+
+def _take(result: _Result) -> Result:
+    try:
+        message = ctypes.string_at(result.message, result.message_size)
+        return Result(result.status, message.decode('utf-8', 'replace'))
+    finally:
+        _library.oicompare_result_free(ctypes.byref(result))
+
+
+def _encode(value: Optional[_Path]) -> Optional[bytes]:
+    if value is None or isinstance(value, bytes):
+        return value
+    return os.fsencode(value)
+
+
+def version() -> str:
+    """Returns the version of oicompare."""
+    return _library.oicompare_version().decode()
+
+
+def compare_files(expected: _Path, received: _Path,
+                  translation: Optional[str] = None) -> Result:
+    """Compares two files, as `oicompare EXPECTED RECEIVED TRANSLATION`.
+
+    The translation is english_terse by default."""
+    result = _Result()
+    _library.oicompare_compare_files(_encode(expected), _encode(received),
+                                     _encode(translation),
+                                     ctypes.byref(result))
+    return _take(result)
+
+
+def compare_buffers(expected: bytes, received: bytes,
+                    translation: Optional[str] = None) -> Result:
+    """Compares two outputs in memory, of which the expected one may be
+    compiled."""
+    result = _Result()
+    _library.oicompare_compare_buffers(expected, len(expected), received,
+                                       len(received), _encode(translation),
+                                       ctypes.byref(result))
+    return _take(result)
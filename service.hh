@@ -0,0 +1,908 @@
+#ifndef __OICOMPARE_SERVICE_HH__
+#define __OICOMPARE_SERVICE_HH__
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "io.hh"
+#include "thread_pool.hh"
+#include "translations.hh"
+
+namespace oicompare::service
+{
+namespace detail
+{
+#ifdef MSG_NOSIGNAL
+constexpr int send_flags = MSG_NOSIGNAL;
+#else
+constexpr int send_flags = 0;
+#endif
+
+/**
+ * Maximum number of file descriptors passed with a request.
+ */
+constexpr std::size_t max_fds = 2;
+
+/**
+ * Maximum size of a message, larger ones are rejected.
+ */
+constexpr std::uint32_t max_message_size = std::uint32_t{1} << 20;
+
+[[noreturn]] inline void
+throw_errno (const char *what)
+{
+  throw std::system_error{errno, std::generic_category (), what};
+}
+
+/**
+ * An owned file descriptor.
+ */
+class unique_fd
+{
+public:
+  explicit unique_fd (int fd = -1) noexcept : fd_{fd} {}
+
+  unique_fd (unique_fd &&other) noexcept : fd_{std::exchange (other.fd_, -1)}
+  {
+  }
+
+  unique_fd &
+  operator= (unique_fd &&other) noexcept
+  {
+    std::swap (fd_, other.fd_);
+    return *this;
+  }
+
+  ~unique_fd ()
+  {
+    if (fd_ >= 0)
+      ::close (fd_);
+  }
+
+  int
+  get () const noexcept
+  {
+    return fd_;
+  }
+
+  int
+  release () noexcept
+  {
+    return std::exchange (fd_, -1);
+  }
+
+private:
+  int fd_;
+};
+
+inline void
+set_nonblocking (int fd, bool nonblocking)
+{
+  int flags = ::fcntl (fd, F_GETFL);
+  if (flags < 0
+      || ::fcntl (fd, F_SETFL,
+                  nonblocking ? flags | O_NONBLOCK : flags & ~O_NONBLOCK)
+             != 0)
+    throw_errno ("fcntl");
+}
+
+inline sockaddr_un
+make_address (const char *path)
+{
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (std::strlen (path) >= sizeof (address.sun_path))
+    throw std::system_error{ENAMETOOLONG, std::generic_category (), path};
+  std::strcpy (address.sun_path, path);
+  return address;
+}
+
+inline void
+send_all (int fd, const char *data, std::size_t size)
+{
+  while (size > 0)
+    {
+      auto result = ::send (fd, data, size, send_flags);
+      if (result < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          throw_errno ("send");
+        }
+      data += result;
+      size -= static_cast<std::size_t> (result);
+    }
+}
+
+/**
+ * Sends a message prefixed with its length, along with the file descriptors.
+ */
+inline void
+send_message (int fd, std::string_view payload,
+              const std::vector<int> &fds = {})
+{
+  if (payload.size () > max_message_size)
+    throw std::system_error{EMSGSIZE, std::generic_category (), "send"};
+
+  auto length = static_cast<std::uint32_t> (payload.size ());
+  std::array<iovec, 2> iov{{
+      {&length, sizeof (length)},
+      {const_cast<char *> (payload.data ()), payload.size ()},
+  }};
+
+  alignas (cmsghdr) char control[CMSG_SPACE (max_fds * sizeof (int))]{};
+  msghdr message{};
+  message.msg_iov = iov.data ();
+  message.msg_iovlen = iov.size ();
+  if (!fds.empty ())
+    {
+      auto size = fds.size () * sizeof (int);
+      message.msg_control = control;
+      message.msg_controllen = CMSG_SPACE (size);
+      auto *header = CMSG_FIRSTHDR (&message);
+      header->cmsg_level = SOL_SOCKET;
+      header->cmsg_type = SCM_RIGHTS;
+      header->cmsg_len = CMSG_LEN (size);
+      std::memcpy (CMSG_DATA (header), fds.data (), size);
+    }
+
+  ssize_t result;
+  while ((result = ::sendmsg (fd, &message, send_flags)) < 0)
+    if (errno != EINTR)
+      throw_errno ("sendmsg");
+
+  // The descriptors went with the first byte, send the rest on its own.
+  auto sent = static_cast<std::size_t> (result);
+  if (sent < sizeof (length))
+    {
+      send_all (fd, reinterpret_cast<const char *> (&length) + sent,
+                sizeof (length) - sent);
+      sent = sizeof (length);
+    }
+  sent -= sizeof (length);
+  send_all (fd, payload.data () + sent, payload.size () - sent);
+}
+
+/**
+ * Receives at most size bytes, taking ownership of any passed file
+ * descriptors. Returns the number of bytes received, which is 0 if the
+ * connection was closed, or -1 if nothing could be received without blocking
+ * and the flags include MSG_DONTWAIT.
+ */
+inline ssize_t
+receive_some (int fd, char *data, std::size_t size,
+              std::vector<unique_fd> &fds, int flags = 0)
+{
+  iovec iov{data, size};
+  alignas (cmsghdr) char control[CMSG_SPACE (max_fds * sizeof (int))];
+  msghdr message{};
+  message.msg_iov = &iov;
+  message.msg_iovlen = 1;
+  message.msg_control = control;
+  message.msg_controllen = sizeof (control);
+
+  ssize_t result;
+  while ((result = ::recvmsg (fd, &message, flags)) < 0)
+    if (errno == EAGAIN || errno == EWOULDBLOCK)
+      return -1;
+    else if (errno != EINTR)
+      throw_errno ("recvmsg");
+
+  for (auto *header = CMSG_FIRSTHDR (&message); header;
+       header = CMSG_NXTHDR (&message, header))
+    if (header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS)
+      {
+        auto count = (header->cmsg_len - CMSG_LEN (0)) / sizeof (int);
+        for (std::size_t i = 0; i < count; ++i)
+          {
+            int passed;
+            std::memcpy (&passed, CMSG_DATA (header) + i * sizeof (int),
+                         sizeof (int));
+            fds.emplace_back (passed);
+          }
+      }
+
+  return result;
+}
+
+/**
+ * Receives exactly size bytes, taking ownership of any passed file
+ * descriptors. Returns false if the connection was closed before the first
+ * byte.
+ */
+inline bool
+receive_all (int fd, char *data, std::size_t size,
+             std::vector<unique_fd> &fds)
+{
+  std::size_t received = 0;
+  while (received < size)
+    {
+      auto result = receive_some (fd, data + received, size - received, fds);
+      if (result == 0)
+        {
+          if (received == 0)
+            return false;
+          throw std::system_error{ECONNRESET, std::generic_category (),
+                                  "recvmsg"};
+        }
+      received += static_cast<std::size_t> (result);
+    }
+
+  return true;
+}
+
+/**
+ * Receives a message sent by send_message(). Returns false if the connection
+ * was closed.
+ */
+inline bool
+receive_message (int fd, std::string &payload, std::vector<unique_fd> &fds)
+{
+  std::uint32_t length;
+  if (!receive_all (fd, reinterpret_cast<char *> (&length), sizeof (length),
+                    fds))
+    return false;
+  if (length > max_message_size)
+    throw std::system_error{EMSGSIZE, std::generic_category (), "recvmsg"};
+
+  payload.resize (length);
+  if (length > 0 && !receive_all (fd, payload.data (), length, fds))
+    throw std::system_error{ECONNRESET, std::generic_category (), "recvmsg"};
+  return true;
+}
+
+/**
+ * Reads a message sent by send_message() as its data arrives, without ever
+ * waiting for it.
+ */
+class message_reader
+{
+public:
+  /**
+   * Receives the data of the message which is available, but no data past
+   * its end.
+   *
+   * @return whether the message is complete
+   * @throws std::system_error if the connection was closed or is broken, or
+   * the message is too large
+   */
+  bool
+  read (int fd)
+  {
+    while (true)
+      {
+        char *data;
+        std::size_t size;
+        if (received_ < sizeof (length_))
+          {
+            data = reinterpret_cast<char *> (&length_) + received_;
+            size = sizeof (length_) - received_;
+          }
+        else if (auto offset = received_ - sizeof (length_);
+                 offset < payload_.size ())
+          {
+            data = payload_.data () + offset;
+            size = payload_.size () - offset;
+          }
+        else
+          return true;
+
+        auto result = receive_some (fd, data, size, fds_, MSG_DONTWAIT);
+        if (result < 0)
+          return false;
+        else if (result == 0)
+          throw std::system_error{ECONNRESET, std::generic_category (),
+                                  "recvmsg"};
+
+        received_ += static_cast<std::size_t> (result);
+        if (received_ == sizeof (length_))
+          {
+            if (length_ > max_message_size)
+              throw std::system_error{EMSGSIZE, std::generic_category (),
+                                      "recvmsg"};
+            payload_.resize (length_);
+          }
+      }
+  }
+
+  /**
+   * Takes the complete message, and starts reading the next one.
+   */
+  void
+  take (std::string &payload, std::vector<unique_fd> &fds)
+  {
+    payload = std::move (payload_);
+    fds = std::move (fds_);
+    payload_.clear ();
+    fds_.clear ();
+    received_ = 0;
+  }
+
+private:
+  std::uint32_t length_ = 0;
+  std::size_t received_ = 0;
+  std::string payload_;
+  std::vector<unique_fd> fds_;
+};
+
+/**
+ * Splits a payload into fields separated by null characters.
+ */
+inline std::vector<std::string_view>
+split_fields (std::string_view payload)
+{
+  std::vector<std::string_view> fields;
+  while (true)
+    {
+      auto end = payload.find ('\0');
+      fields.push_back (payload.substr (0, end));
+      if (end == std::string_view::npos)
+        return fields;
+      payload.remove_prefix (end + 1);
+    }
+}
+}
+
+/**
+ * Reply to a request: the exit code of the comparison and the message of the
+ * translation.
+ */
+struct response
+{
+  int status;
+  std::string message;
+};
+
+/**
+ * Counters of the served comparisons.
+ *
+ * Latencies are kept in a histogram of buckets whose bounds grow
+ * geometrically, 8 buckets for every power of two, so percentiles are accurate
+ * to within 12.5%.
+ */
+class statistics
+{
+public:
+  /**
+   * Records a comparison.
+   *
+   * @param bytes total size of the compared inputs
+   * @param latency time taken to serve the request
+   */
+  void
+  record (std::size_t bytes, std::chrono::nanoseconds latency) noexcept
+  {
+    requests_.fetch_add (1, std::memory_order_relaxed);
+    bytes_.fetch_add (bytes, std::memory_order_relaxed);
+
+    auto value = static_cast<std::uint64_t> (
+        std::max (latency.count (), std::chrono::nanoseconds::rep{0}));
+    buckets_[bucket (value)].fetch_add (1, std::memory_order_relaxed);
+  }
+
+  /**
+   * Number of comparisons.
+   */
+  std::uint64_t
+  requests () const noexcept
+  {
+    return requests_.load (std::memory_order_relaxed);
+  }
+
+  /**
+   * Total size of the compared inputs.
+   */
+  std::uint64_t
+  bytes () const noexcept
+  {
+    return bytes_.load (std::memory_order_relaxed);
+  }
+
+  /**
+   * Latency below which the given fraction of comparisons finished, rounded
+   * down to the bound of its bucket.
+   *
+   * @param fraction fraction between 0 and 1
+   */
+  std::chrono::nanoseconds
+  percentile (double fraction) const noexcept
+  {
+    std::array<std::uint64_t, bucket_count> counts;
+    std::uint64_t total = 0;
+    for (std::size_t i = 0; i < bucket_count; ++i)
+      total += counts[i] = buckets_[i].load (std::memory_order_relaxed);
+    if (total == 0)
+      return {};
+
+    auto rank = static_cast<std::uint64_t> (fraction * (total - 1));
+    std::size_t i = 0;
+    for (std::uint64_t seen = counts[0]; seen <= rank; seen += counts[++i])
+      ;
+    return std::chrono::nanoseconds{
+        static_cast<std::chrono::nanoseconds::rep> (lower_bound (i))};
+  }
+
+  /**
+   * Formats the counters, one per line in the form "NAME VALUE".
+   */
+  void
+  format (fmt::memory_buffer &buffer) const
+  {
+    auto out = std::back_inserter (buffer);
+    fmt::format_to (out, "requests {}\nbytes {}\n", requests (), bytes ());
+    for (auto percent : {50, 90, 99})
+      fmt::format_to (out, "latency_p{}_ns {}\n", percent,
+                      percentile (percent / 100.0).count ());
+  }
+
+private:
+  static constexpr std::size_t sub_buckets = 8;
+  static constexpr std::size_t bucket_count = 62 * sub_buckets;
+
+  static constexpr std::size_t
+  bucket (std::uint64_t value) noexcept
+  {
+    if (value < sub_buckets)
+      return value;
+    auto octave = static_cast<std::size_t> (std::bit_width (value)) - 1;
+    auto sub = (value >> (octave - 3)) & (sub_buckets - 1);
+    return (octave - 2) * sub_buckets + sub;
+  }
+
+  static constexpr std::uint64_t
+  lower_bound (std::size_t bucket) noexcept
+  {
+    if (bucket < sub_buckets)
+      return bucket;
+    auto octave = bucket / sub_buckets + 2;
+    return (sub_buckets + bucket % sub_buckets) << (octave - 3);
+  }
+
+  std::atomic<std::uint64_t> requests_ = 0;
+  std::atomic<std::uint64_t> bytes_ = 0;
+  std::array<std::atomic<std::uint64_t>, bucket_count> buckets_{};
+};
+
+/**
+ * A daemon comparing files on request, listening on a Unix domain socket.
+ *
+ * Every request and response is prefixed with its length, as a 32-bit
+ * unsigned integer in the host byte order. A request consists of fields
+ * separated by null characters:
+ *
+ *   - "compare", TRANSLATION, PATH1, PATH2 compares two files by their paths,
+ *   - "compare_fds", TRANSLATION compares two open files, whose descriptors
+ *     are passed along with the request (as SCM_RIGHTS),
+ *   - "statistics" returns the counters of the server.
+ *
+ * A response consists of a byte with the exit code, followed by the message.
+ *
+ * A single thread reads the requests of all the connections as their data
+ * arrives, and every complete request is served by a task of a fixed pool of
+ * threads. Each connection may send any number of requests, and holds no
+ * thread while it sends one or between them, so a stalled client cannot keep
+ * others waiting. Sending a response gives up after send_timeout.
+ */
+class server
+{
+public:
+  /**
+   * Time after which a client which does not take its response is
+   * disconnected.
+   */
+  static constexpr std::chrono::seconds send_timeout{10};
+
+  /**
+   * Starts listening, replacing a stale socket at the path.
+   *
+   * @param path path of the socket
+   * @param threads number of threads serving requests
+   */
+  explicit server (const char *path,
+                   std::size_t threads = std::thread::hardware_concurrency ())
+      : path_{path}, threads_{threads},
+        socket_{::socket (AF_UNIX, SOCK_STREAM, 0)}
+  {
+    if (socket_.get () < 0)
+      detail::throw_errno ("socket");
+    // A connection may go away between poll() and accept().
+    detail::set_nonblocking (socket_.get (), true);
+
+    int wake[2];
+    if (::pipe (wake) != 0)
+      detail::throw_errno ("pipe");
+    wake_read_ = detail::unique_fd{wake[0]};
+    wake_write_ = detail::unique_fd{wake[1]};
+    detail::set_nonblocking (wake[0], true);
+    detail::set_nonblocking (wake[1], true);
+
+    auto address = detail::make_address (path);
+    struct stat status;
+    if (::lstat (path, &status) == 0 && S_ISSOCK (status.st_mode))
+      ::unlink (path);
+
+    if (::bind (socket_.get (), reinterpret_cast<sockaddr *> (&address),
+                sizeof (address))
+        != 0)
+      detail::throw_errno (path);
+    if (::listen (socket_.get (), SOMAXCONN) != 0)
+      {
+        ::unlink (path);
+        detail::throw_errno ("listen");
+      }
+  }
+
+  server (const server &) = delete;
+  server &operator= (const server &) = delete;
+
+  ~server () { ::unlink (path_.c_str ()); }
+
+  /**
+   * Accepts connections and serves their requests until stop() is called.
+   */
+  void
+  run ()
+  {
+    {
+      thread_pool pool{threads_};
+      std::vector<pollfd> polled;
+
+      while (true)
+        {
+          {
+            std::lock_guard lock{mutex_};
+            if (stopping_)
+              break;
+
+            polled.clear ();
+            polled.push_back ({socket_.get (), POLLIN, 0});
+            polled.push_back ({wake_read_.get (), POLLIN, 0});
+            for (int fd : idle_)
+              polled.push_back ({fd, POLLIN, 0});
+          }
+
+          if (::poll (polled.data (), polled.size (), -1) < 0)
+            {
+              if (errno == EINTR)
+                continue;
+              detail::throw_errno ("poll");
+            }
+
+          if (polled[1].revents != 0)
+            {
+              char drained[64];
+              while (::read (wake_read_.get (), drained, sizeof (drained)) > 0)
+                ;
+            }
+          if (polled[0].revents != 0)
+            accept_connection ();
+
+          // Each complete request is answered by a task of its own, after
+          // which the connection is polled again.
+          std::lock_guard lock{mutex_};
+          for (auto it = polled.begin () + 2; it != polled.end (); ++it)
+            if (it->revents != 0)
+              {
+                bool complete;
+                try
+                  {
+                    complete = connections_.at (it->fd).reader.read (it->fd);
+                  }
+                catch (const std::exception &)
+                  {
+                    // The client closed it, or it is broken.
+                    idle_.erase (it->fd);
+                    connections_.erase (it->fd);
+                    continue;
+                  }
+
+                if (complete)
+                  {
+                    idle_.erase (it->fd);
+                    pool.submit ([this, fd = it->fd] { serve (fd); });
+                  }
+              }
+        }
+    }
+
+    // The connections whose requests were being served are closed by their
+    // tasks, the others are closed here.
+    std::lock_guard lock{mutex_};
+    idle_.clear ();
+    connections_.clear ();
+  }
+
+  /**
+   * Makes run() return once the requests being served are answered.
+   * Connections are closed after their current requests.
+   */
+  void
+  stop ()
+  {
+    std::lock_guard lock{mutex_};
+    stopping_ = true;
+    wake ();
+  }
+
+  /**
+   * Counters of the served comparisons.
+   */
+  const service::statistics &
+  statistics () const noexcept
+  {
+    return statistics_;
+  }
+
+private:
+  /**
+   * Wakes up run() waiting in poll(). The caller holds mutex_.
+   */
+  void
+  wake () noexcept
+  {
+    // A full pipe wakes it up already.
+    char byte = 0;
+    static_cast<void> (::write (wake_write_.get (), &byte, 1));
+  }
+
+  void
+  accept_connection ()
+  {
+    detail::unique_fd connection{::accept (socket_.get (), nullptr, nullptr)};
+    if (connection.get () < 0)
+      {
+        if (errno == EINTR || errno == ECONNABORTED || errno == EAGAIN
+            || errno == EWOULDBLOCK)
+          return;
+        detail::throw_errno ("accept");
+      }
+    // Requests are read without waiting, and responses are sent by tasks
+    // which wait for a while at most.
+    detail::set_nonblocking (connection.get (), false);
+    timeval timeout{send_timeout.count (), 0};
+    if (::setsockopt (connection.get (), SOL_SOCKET, SO_SNDTIMEO, &timeout,
+                      sizeof (timeout))
+        != 0)
+      detail::throw_errno ("setsockopt");
+
+    std::lock_guard lock{mutex_};
+    int fd = connection.get ();
+    idle_.insert (fd);
+    connections_.emplace (fd, connection_state{std::move (connection), {}});
+  }
+
+  /**
+   * Answers the complete request of a connection, then gives the connection
+   * back to run(). It is closed instead if it is broken or the server is
+   * stopping.
+   */
+  void
+  serve (int fd)
+  {
+    std::string payload;
+    std::vector<detail::unique_fd> fds;
+    {
+      std::lock_guard lock{mutex_};
+      connections_.at (fd).reader.take (payload, fds);
+    }
+
+    bool open = false;
+    try
+      {
+        fmt::memory_buffer buffer;
+        buffer.push_back ('\0');
+        auto status = handle (payload, fds, buffer);
+        buffer[0] = static_cast<char> (status);
+        fds.clear ();
+
+        detail::send_message (fd, {buffer.data (), buffer.size ()});
+        open = true;
+      }
+    catch (const std::exception &)
+      {
+        // The connection is broken, there is no one to report to.
+      }
+
+    std::lock_guard lock{mutex_};
+    if (open && !stopping_)
+      {
+        idle_.insert (fd);
+        wake ();
+      }
+    else
+      connections_.erase (fd);
+  }
+
+  int
+  handle (std::string_view payload, const std::vector<detail::unique_fd> &fds,
+          fmt::memory_buffer &buffer)
+  {
+    using namespace std::string_view_literals;
+
+    auto out = std::back_inserter (buffer);
+    auto fields = detail::split_fields (payload);
+
+    if (fields.size () == 1 && fields[0] == "statistics"sv)
+      {
+        statistics_.format (buffer);
+        return EXIT_SUCCESS;
+      }
+
+    bool by_path = fields.size () == 4 && fields[0] == "compare"sv;
+    bool by_fds = fields.size () == 2 && fields[0] == "compare_fds"sv;
+    if (!by_path && !by_fds)
+      {
+        fmt::format_to (out, "Invalid request\n");
+        return 2;
+      }
+    else if (by_fds && fds.size () != 2)
+      {
+        fmt::format_to (out, "Expected 2 file descriptors, got {}\n",
+                        fds.size ());
+        return 2;
+      }
+    else if (by_path)
+      // The standard input of the server is not an input of a client.
+      for (auto path : {fields[2], fields[3]})
+        if (path.empty () || path == "-"sv)
+          {
+            fmt::format_to (out, "Invalid path: \"{}\"\n", path);
+            return 2;
+          }
+
+    auto format = translations::parse (fields[1]);
+    if (!format)
+      {
+        fmt::format_to (out, "Unknown translation: {}\n", fields[1]);
+        return 2;
+      }
+
+    auto start = std::chrono::steady_clock::now ();
+    std::size_t bytes = 0;
+    int status;
+    try
+      {
+        if (by_path)
+          status = io::compare_files (std::string{fields[2]}.c_str (),
+                                      std::string{fields[3]}.c_str (),
+                                      format, buffer, {}, &bytes);
+        else
+          status = io::compare_fds (fds[0].get (), fds[1].get (), format,
+                                    buffer, {}, &bytes);
+      }
+    catch (const std::exception &e)
+      {
+        buffer.resize (1);
+        fmt::format_to (out, "{}\n", e.what ());
+        status = 2;
+      }
+
+    statistics_.record (bytes, std::chrono::steady_clock::now () - start);
+    return status;
+  }
+
+  std::string path_;
+  std::size_t threads_;
+  detail::unique_fd socket_;
+  service::statistics statistics_;
+
+  detail::unique_fd wake_read_;
+  detail::unique_fd wake_write_;
+
+  struct connection_state
+  {
+    detail::unique_fd fd;
+    // Read by run() while the connection is idle.
+    detail::message_reader reader;
+  };
+
+  std::mutex mutex_;
+  // The open connections, and those of them waiting for a request.
+  std::unordered_map<int, connection_state> connections_;
+  std::unordered_set<int> idle_;
+  bool stopping_ = false;
+};
+
+/**
+ * A connection to a server.
+ */
+class client
+{
+public:
+  /**
+   * Connects to the server.
+   *
+   * @param path path of the socket
+   */
+  explicit client (const char *path)
+      : socket_{::socket (AF_UNIX, SOCK_STREAM, 0)}
+  {
+    if (socket_.get () < 0)
+      detail::throw_errno ("socket");
+
+    auto address = detail::make_address (path);
+    if (::connect (socket_.get (), reinterpret_cast<sockaddr *> (&address),
+                   sizeof (address))
+        != 0)
+      detail::throw_errno (path);
+  }
+
+  /**
+   * Compares two files by their paths, which are resolved by the server.
+   */
+  response
+  compare (std::string_view translation, std::string_view path1,
+           std::string_view path2)
+  {
+    return request (fmt::format ("compare{0}{1}{0}{2}{0}{3}", '\0',
+                                 translation, path1, path2));
+  }
+
+  /**
+   * Compares two open files, passing their descriptors to the server.
+   */
+  response
+  compare (std::string_view translation, int fd1, int fd2)
+  {
+    return request (fmt::format ("compare_fds{}{}", '\0', translation),
+                    {fd1, fd2});
+  }
+
+  /**
+   * Returns the counters of the server, one per line in the form
+   * "NAME VALUE".
+   */
+  response
+  statistics ()
+  {
+    return request ("statistics");
+  }
+
+private:
+  response
+  request (std::string_view payload, const std::vector<int> &fds = {})
+  {
+    detail::send_message (socket_.get (), payload, fds);
+
+    std::string reply;
+    std::vector<detail::unique_fd> unexpected_fds;
+    if (!detail::receive_message (socket_.get (), reply, unexpected_fds)
+        || reply.empty ())
+      throw std::system_error{ECONNRESET, std::generic_category (),
+                              "recvmsg"};
+
+    return {static_cast<unsigned char> (reply[0]), reply.substr (1)};
+  }
+
+  detail::unique_fd socket_;
+};
+}
+
+#endif /* __OICOMPARE_SERVICE_HH__ */
\ No newline at end of file
@@ -0,0 +1,222 @@
+#ifndef __OICOMPARE_SIMD_HH__
+#define __OICOMPARE_SIMD_HH__
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace oicompare::detail::simd
+{
+/**
+ * Bit mask of a vector classification, bit i corresponds to byte i.
+ */
+using mask = std::uint32_t;
+
+#if defined(__AVX2__)
+/**
+ * Whether vector kernels are available on this target.
+ */
+constexpr bool available = true;
+
+/**
+ * Number of bytes processed at once.
+ */
+constexpr std::size_t width = 32;
+
+/**
+ * A vector of bytes.
+ */
+struct vector
+{
+  __m256i value;
+
+  static vector
+  load (const char *ptr) noexcept
+  {
+    return {_mm256_loadu_si256 (reinterpret_cast<const __m256i *> (ptr))};
+  }
+
+  /**
+   * Bytes equal to ch are set to all ones, others to zero.
+   */
+  vector
+  eq (char ch) const noexcept
+  {
+    return {_mm256_cmpeq_epi8 (value, _mm256_set1_epi8 (ch))};
+  }
+
+  vector
+  eq (const vector &other) const noexcept
+  {
+    return {_mm256_cmpeq_epi8 (value, other.value)};
+  }
+
+  /**
+   * Bytes between low and high (inclusive, both in the ASCII range) are set
+   * to all ones, others to zero.
+   */
+  vector
+  between (char low, char high) const noexcept
+  {
+    return {_mm256_andnot_si256 (
+        _mm256_cmpgt_epi8 (_mm256_set1_epi8 (low), value),
+        _mm256_cmpgt_epi8 (_mm256_set1_epi8 (static_cast<char> (high + 1)),
+                           value))};
+  }
+
+  vector
+  operator| (const vector &other) const noexcept
+  {
+    return {_mm256_or_si256 (value, other.value)};
+  }
+
+  vector
+  operator& (const vector &other) const noexcept
+  {
+    return {_mm256_and_si256 (value, other.value)};
+  }
+
+  /**
+   * Gathers the top bits of each byte.
+   */
+  mask
+  bits () const noexcept
+  {
+    return static_cast<mask> (_mm256_movemask_epi8 (value));
+  }
+};
+#elif defined(__SSE2__)
+constexpr bool available = true;
+constexpr std::size_t width = 16;
+
+struct vector
+{
+  __m128i value;
+
+  static vector
+  load (const char *ptr) noexcept
+  {
+    return {_mm_loadu_si128 (reinterpret_cast<const __m128i *> (ptr))};
+  }
+
+  vector
+  eq (char ch) const noexcept
+  {
+    return {_mm_cmpeq_epi8 (value, _mm_set1_epi8 (ch))};
+  }
+
+  vector
+  eq (const vector &other) const noexcept
+  {
+    return {_mm_cmpeq_epi8 (value, other.value)};
+  }
+
+  vector
+  between (char low, char high) const noexcept
+  {
+    return {_mm_andnot_si128 (
+        _mm_cmpgt_epi8 (_mm_set1_epi8 (low), value),
+        _mm_cmpgt_epi8 (_mm_set1_epi8 (static_cast<char> (high + 1)),
+                        value))};
+  }
+
+  vector
+  operator| (const vector &other) const noexcept
+  {
+    return {_mm_or_si128 (value, other.value)};
+  }
+
+  vector
+  operator& (const vector &other) const noexcept
+  {
+    return {_mm_and_si128 (value, other.value)};
+  }
+
+  mask
+  bits () const noexcept
+  {
+    return static_cast<mask> (_mm_movemask_epi8 (value));
+  }
+};
+#else
+// No vector unit we know of, so callers use their scalar loops. The portable
+// definition below only keeps the kernels well-formed.
+constexpr bool available = false;
+constexpr std::size_t width = 8;
+
+struct vector
+{
+  char value[width];
+
+  static vector
+  load (const char *ptr) noexcept
+  {
+    vector result;
+    for (std::size_t i = 0; i < width; ++i)
+      result.value[i] = ptr[i];
+    return result;
+  }
+
+  vector
+  eq (char ch) const noexcept
+  {
+    vector result;
+    for (std::size_t i = 0; i < width; ++i)
+      result.value[i] = value[i] == ch ? '\xFF' : '\0';
+    return result;
+  }
+
+  vector
+  eq (const vector &other) const noexcept
+  {
+    vector result;
+    for (std::size_t i = 0; i < width; ++i)
+      result.value[i] = value[i] == other.value[i] ? '\xFF' : '\0';
+    return result;
+  }
+
+  vector
+  between (char low, char high) const noexcept
+  {
+    vector result;
+    for (std::size_t i = 0; i < width; ++i)
+      result.value[i] = value[i] >= low && value[i] <= high ? '\xFF' : '\0';
+    return result;
+  }
+
+  vector
+  operator| (const vector &other) const noexcept
+  {
+    vector result;
+    for (std::size_t i = 0; i < width; ++i)
+      result.value[i] = static_cast<char> (value[i] | other.value[i]);
+    return result;
+  }
+
+  vector
+  operator& (const vector &other) const noexcept
+  {
+    vector result;
+    for (std::size_t i = 0; i < width; ++i)
+      result.value[i] = static_cast<char> (value[i] & other.value[i]);
+    return result;
+  }
+
+  mask
+  bits () const noexcept
+  {
+    mask result = 0;
+    for (std::size_t i = 0; i < width; ++i)
+      result |= static_cast<mask> ((value[i] & 0x80) != 0) << i;
+    return result;
+  }
+};
+#endif
+}
+
+#endif /* __OICOMPARE_SIMD_HH__ */
\ No newline at end of file
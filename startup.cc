@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <tuple>
+#include <vector>
+
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "io.hh"
+
+using namespace std::string_view_literals;
+
+/*
+ * Measures the time from exec to exit of comparators on small files, as most
+ * outputs of tests are, where it is dominated by the startup of the process
+ * rather than by the comparison.
+ */
+
+namespace
+{
+/**
+ * Runs a program to its exit, with its standard output and error discarded.
+ *
+ * @return exit code
+ */
+int
+run (const std::vector<const char *> &args)
+{
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init (&actions);
+  posix_spawn_file_actions_addopen (&actions, STDOUT_FILENO, "/dev/null",
+                                    O_WRONLY, 0);
+  posix_spawn_file_actions_addopen (&actions, STDERR_FILENO, "/dev/null",
+                                    O_WRONLY, 0);
+
+  pid_t pid;
+  int error = ::posix_spawn (&pid, args[0], &actions, nullptr,
+                             const_cast<char *const *> (args.data ()),
+                             environ);
+  posix_spawn_file_actions_destroy (&actions);
+  if (error != 0)
+    throw std::system_error{error, std::generic_category (), args[0]};
+
+  int status;
+  while (::waitpid (pid, &status, 0) < 0)
+    if (errno != EINTR)
+      throw std::system_error{errno, std::generic_category (), "waitpid"};
+  return WIFEXITED (status) ? WEXITSTATUS (status) : 2;
+}
+
+/**
+ * Prints a result as a line of JSON.
+ */
+void
+report (std::string_view program, std::string_view workload,
+        std::vector<double> &micros)
+{
+  std::ranges::sort (micros);
+  double sum = 0;
+  for (auto value : micros)
+    sum += value;
+  fmt::println ("{{\"program\": \"{}\", \"workload\": \"{}\", \"runs\": {}, "
+                "\"best_us\": {:.1f}, \"median_us\": {:.1f}, "
+                "\"mean_us\": {:.1f}}}",
+                program, workload, micros.size (), micros.front (),
+                micros[micros.size () / 2],
+                sum / static_cast<double> (micros.size ()));
+}
+}
+
+int
+main (int argc, char **argv)
+{
+  std::size_t runs = 1000;
+  std::vector<const char *> programs;
+
+  for (int i = 1; i < argc; ++i)
+    {
+      std::string_view arg{argv[i]};
+      if (arg.starts_with ("--runs="sv))
+        runs = std::strtoull (argv[i] + 7, nullptr, 10);
+      else if (!arg.starts_with ('-'))
+        programs.push_back (argv[i]);
+      else
+        {
+          programs.clear ();
+          break;
+        }
+    }
+
+  if (programs.empty () || runs == 0)
+    {
+      fmt::println (stderr, "Usage: {} [--runs=N] PROGRAM...", argv[0]);
+      return 2;
+    }
+
+  // A typical output of a test, of about a kilobyte.
+  std::string expected;
+  for (std::size_t i = 0; expected.size () < 1024; ++i)
+    expected += fmt::format ("{} {}\n", i, i * i % 1000003);
+  std::string received = expected;
+  received[received.size () - 2] ^= 1;
+
+  auto directory = std::filesystem::temp_directory_path ()
+                   / fmt::format ("oicompare-startup-{}", ::getpid ());
+  std::filesystem::create_directories (directory);
+
+  int status = EXIT_SUCCESS;
+  try
+    {
+      auto expected_path = directory / "expected";
+      auto equal_path = directory / "equal";
+      auto wrong_path = directory / "wrong";
+      oicompare::io::write_file (expected_path.c_str (), expected);
+      oicompare::io::write_file (equal_path.c_str (), expected);
+      oicompare::io::write_file (wrong_path.c_str (), received);
+
+      for (const auto *program : programs)
+        for (const auto &[workload, path, expected_status] :
+             {std::tuple{"equal"sv, equal_path.c_str (), EXIT_SUCCESS},
+              std::tuple{"wrong"sv, wrong_path.c_str (), EXIT_FAILURE}})
+          {
+            std::vector<const char *> args{program, expected_path.c_str (),
+                                           path, "english_full", nullptr};
+            std::vector<double> micros;
+            for (std::size_t i = 0; i < runs; ++i)
+              {
+                auto start = std::chrono::steady_clock::now ();
+                if (run (args) != expected_status)
+                  throw std::runtime_error{
+                      fmt::format ("{}: unexpected exit code", program)};
+                micros.push_back (std::chrono::duration<double, std::micro> (
+                                      std::chrono::steady_clock::now ()
+                                      - start)
+                                      .count ());
+              }
+            report (program, workload, micros);
+          }
+    }
+  catch (const std::exception &e)
+    {
+      fmt::println (stderr, "{}", e.what ());
+      status = 2;
+    }
+
+  std::filesystem::remove_all (directory);
+  return status;
+}
\ No newline at end of file
@@ -0,0 +1,537 @@
+#ifndef __OICOMPARE_STREAM_HH__
+#define __OICOMPARE_STREAM_HH__
+
+#include <algorithm>
+#include <cerrno>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <system_error>
+#include <tuple>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "oicompare.hh"
+
+namespace oicompare
+{
+/**
+ * A source of input which is mapped in memory a window at a time.
+ *
+ * map() returns the input from an offset on, as much of it as fits in the
+ * window, which is valid until the next call. size() is the size of the input
+ * and window_size() is that of the window.
+ */
+template <typename S>
+concept mapped_source = requires (S &source, std::uint64_t offset) {
+  {
+    source.map (offset)
+  } -> std::same_as<std::string_view>;
+  {
+    source.size ()
+  } -> std::same_as<std::uint64_t>;
+  {
+    source.window_size ()
+  } -> std::same_as<std::size_t>;
+};
+
+/**
+ * A sequential source of input, either a mapped_source or one which is read.
+ *
+ * read() fills at most size bytes of the buffer and returns their count, or
+ * zero at the end of input.
+ */
+template <typename S>
+concept stream_source
+    = mapped_source<S>
+      || requires (S &source, char *buffer, std::size_t size) {
+           {
+             source.read (buffer, size)
+           } -> std::same_as<std::size_t>;
+         };
+
+/**
+ * A stream source reading from a file descriptor.
+ */
+class fd_source
+{
+public:
+  /**
+   * Reads from a file descriptor owned by the caller.
+   *
+   * @param fd file descriptor
+   */
+  explicit fd_source (int fd) noexcept : fd_{fd}, owned_{false} {}
+
+  /**
+   * Opens a file for reading.
+   *
+   * @param path path to the file
+   */
+  explicit fd_source (const char *path) : fd_{::open (path, O_RDONLY)}
+  {
+    if (fd_ < 0)
+      throw std::system_error{errno, std::generic_category (), path};
+  }
+
+  fd_source (fd_source &&other) noexcept
+      : fd_{std::exchange (other.fd_, -1)}, owned_{other.owned_}
+  {
+  }
+
+  fd_source &
+  operator= (fd_source &&other) noexcept
+  {
+    std::swap (fd_, other.fd_);
+    std::swap (owned_, other.owned_);
+    return *this;
+  }
+
+  ~fd_source ()
+  {
+    if (owned_ && fd_ >= 0)
+      ::close (fd_);
+  }
+
+  /**
+   * The file descriptor.
+   */
+  int
+  fd () const noexcept
+  {
+    return fd_;
+  }
+
+  std::size_t
+  read (char *buffer, std::size_t size)
+  {
+    while (true)
+      {
+        auto result = ::read (fd_, buffer, size);
+        if (result >= 0)
+          return static_cast<std::size_t> (result);
+        else if (errno != EINTR)
+          throw std::system_error{errno, std::generic_category (), "read"};
+      }
+  }
+
+private:
+  int fd_;
+  bool owned_ = true;
+};
+
+/**
+ * A stream source reading from memory.
+ */
+class view_source
+{
+public:
+  explicit view_source (std::string_view data) noexcept : data_{data} {}
+
+  std::size_t
+  read (char *buffer, std::size_t size) noexcept
+  {
+    auto count = std::min (size, data_.size ());
+    std::memcpy (buffer, data_.data (), count);
+    data_.remove_prefix (count);
+    return count;
+  }
+
+private:
+  std::string_view data_;
+};
+
+/**
+ * Default size of the buffer of a stream_reader.
+ */
+constexpr std::size_t default_stream_buffer_size = std::size_t{1} << 18;
+
+template <stream_source Source> class stream_reader;
+
+namespace detail
+{
+template <stream_source Source1, stream_source Source2,
+          counters_hook Counters>
+std::optional<mismatch<const char *, const char *>>
+compare_streams (stream_reader<Source1> &reader1,
+                 stream_reader<Source2> &reader2, const tolerance *tolerance,
+                 Counters &counters);
+}
+
+/**
+ * Reads a stream source in chunks into a fixed-size buffer, keeping only the
+ * current token. A mapped source is read in place instead, with its window
+ * taking the part of the buffer.
+ *
+ * A token longer than the buffer is still compared in full, but only the part
+ * of it which fits in the buffer is kept for the report.
+ */
+template <stream_source Source> class stream_reader
+{
+public:
+  /**
+   * @param source source of input
+   * @param buffer_size size of the buffer, at least 2
+   */
+  explicit stream_reader (Source source,
+                          std::size_t buffer_size = default_stream_buffer_size)
+      : source_{std::move (source)},
+        size_{std::max (buffer_size, std::size_t{2})},
+        buffer_{mapped_source<Source> ? nullptr : new char[size_]},
+        mark_{buffer_.get ()}, pos_{mark_}, end_{buffer_.get ()}
+  {
+  }
+
+  /**
+   * Number of bytes read from the source so far.
+   */
+  std::size_t
+  bytes_read () const noexcept
+  {
+    return bytes_read_;
+  }
+
+  /**
+   * Offset in the input of a position in the buffer, like the beginning of a
+   * reported token.
+   */
+  std::size_t
+  offset (const char *position) const noexcept
+  {
+    return bytes_read_ - static_cast<std::size_t> (end_ - position);
+  }
+
+private:
+  template <stream_source S1, stream_source S2, counters_hook Counters>
+  friend std::optional<mismatch<const char *, const char *>>
+  detail::compare_streams (stream_reader<S1> &, stream_reader<S2> &,
+                           const tolerance *, Counters &);
+
+  /**
+   * Reads more data after end_, discarding the data before mark_.
+   *
+   * If the buffer is full, the beginning of the current token is discarded
+   * (and it is marked as truncated), unless keep is set. Returns whether any
+   * data was read.
+   */
+  bool
+  fill (bool keep = false)
+  {
+    if (eof_)
+      return false;
+
+    if constexpr (mapped_source<Source>)
+      {
+        if (bytes_read_ == source_.size ())
+          {
+            eof_ = true;
+            return false;
+          }
+
+        if (static_cast<std::size_t> (end_ - mark_) == source_.window_size ())
+          {
+            if (keep)
+              return false;
+            mark_ = end_ - source_.window_size () / 2;
+            truncated_ = true;
+          }
+
+        // The window is mapped again from mark_ on.
+        auto kept = static_cast<std::size_t> (end_ - mark_);
+        auto data = source_.map (bytes_read_ - kept);
+        pos_ = data.data () + (pos_ - mark_);
+        mark_ = data.data ();
+        end_ = data.data () + data.size ();
+        bytes_read_ += data.size () - kept;
+        return true;
+      }
+    else
+      {
+        auto *buffer = buffer_.get ();
+        if (mark_ == buffer && end_ == buffer + size_)
+          {
+            if (keep)
+              return false;
+            mark_ = end_ - size_ / 2;
+            truncated_ = true;
+          }
+
+        if (mark_ != buffer)
+          {
+            auto shift = mark_ - buffer;
+            std::memmove (buffer, mark_, end_ - mark_);
+            mark_ -= shift;
+            pos_ -= shift;
+            end_ -= shift;
+          }
+
+        auto used = static_cast<std::size_t> (end_ - buffer);
+        auto count = source_.read (buffer + used, size_ - used);
+        if (count == 0)
+          {
+            eof_ = true;
+            return false;
+          }
+
+        end_ += count;
+        bytes_read_ += count;
+        return true;
+      }
+  }
+
+  /**
+   * Scans the next token, leaving pos_ after it, or at the beginning of the
+   * word (marked by mark_) if it is a word.
+   */
+  token_type
+  next ()
+  {
+    while (true)
+      {
+        mark_ = pos_ = detail::skip_whitespace (pos_, end_);
+        if (pos_ != end_)
+          break;
+        else if (!fill ())
+          return token_type::eof;
+      }
+    truncated_ = false;
+
+    if (*pos_ == '\n')
+      {
+        ++pos_;
+        return token_type::newline;
+      }
+    else
+      return token_type::word;
+  }
+
+  /**
+   * Whether the word at pos_ has ended, reading more data if necessary.
+   */
+  bool
+  word_ended ()
+  {
+    if (pos_ == end_ && !fill ())
+      return true;
+    return detail::is_whitespace (*pos_) || *pos_ == '\n';
+  }
+
+  /**
+   * Reads the rest of the current word, as long as it fits in the buffer.
+   */
+  void
+  complete_word ()
+  {
+    while ((pos_ = detail::find_word_end (pos_, end_)) == end_)
+      if (!fill (true))
+        break;
+  }
+
+  token<const char *>
+  make_token (token_type type) const noexcept
+  {
+    switch (type)
+      {
+      case token_type::word:
+        return {type, mark_, pos_};
+      case token_type::newline:
+        return {type, pos_ - 1, pos_};
+      default:
+        return {type, pos_, pos_};
+      }
+  }
+
+  Source source_;
+  std::size_t size_;
+  std::unique_ptr<char[]> buffer_;
+  const char *mark_;
+  const char *pos_;
+  const char *end_;
+  bool eof_ = false;
+  // Whether the beginning of the current token was discarded.
+  bool truncated_ = false;
+  std::size_t bytes_read_ = 0;
+};
+
+namespace detail
+{
+/**
+ * Compares two streams, comparing numbers with the tolerance if it is not
+ * null, and telling the counters about every token.
+ */
+template <stream_source Source1, stream_source Source2,
+          counters_hook Counters>
+std::optional<mismatch<const char *, const char *>>
+compare_streams (stream_reader<Source1> &reader1,
+                 stream_reader<Source2> &reader2, const tolerance *tolerance,
+                 Counters &counters)
+{
+  std::size_t line_number = 1;
+
+  auto next1 = [&] {
+    auto type = reader1.next ();
+    counters.token (0, type);
+    return type;
+  };
+  auto next2 = [&] {
+    auto type = reader2.next ();
+    counters.token (1, type);
+    return type;
+  };
+
+  // Whether the readers are at the beginning of a line, where the data
+  // buffered by both is compared in bulk.
+  bool line_start = true;
+
+  while (true)
+    {
+      if (line_start)
+        {
+          // Skip the identical prefix of the buffered data, up to the
+          // beginning of the token it ends in, without tokenizing it.
+          auto *pos1 = reader1.pos_;
+          auto available = std::min (reader1.end_ - pos1,
+                                     reader2.end_ - reader2.pos_);
+          auto same = detail::common_prefix (
+              pos1, reader2.pos_, static_cast<std::size_t> (available));
+          auto *boundary = detail::find_last_boundary (pos1, pos1 + same);
+          line_number += detail::count_newlines (pos1, boundary);
+          counters.skip (static_cast<std::size_t> (boundary - pos1));
+          reader2.pos_ += boundary - pos1;
+          reader1.pos_ = boundary;
+          line_start = false;
+        }
+
+      auto type1 = next1 ();
+      auto type2 = next2 ();
+
+      if (type1 == token_type::eof)
+        while (type2 == token_type::newline)
+          type2 = next2 ();
+      else if (type2 == token_type::eof)
+        while (type1 == token_type::newline)
+          type1 = next1 ();
+
+      if (type1 != type2)
+        {
+          if (type1 == token_type::word)
+            reader1.complete_word ();
+          if (type2 == token_type::word)
+            reader2.complete_word ();
+          return {{line_number, std::nullopt, reader1.make_token (type1),
+                   reader2.make_token (type2), std::nullopt}};
+        }
+      else if (type1 == token_type::newline)
+        {
+          ++line_number;
+          line_start = true;
+        }
+      else if (type1 == token_type::eof)
+        break;
+      else
+        {
+          // Compare the words in lockstep, as far as both are buffered.
+          while (true)
+            {
+              auto size = static_cast<std::size_t> (std::min (
+                  detail::find_word_end (reader1.pos_, reader1.end_)
+                      - reader1.pos_,
+                  detail::find_word_end (reader2.pos_, reader2.end_)
+                      - reader2.pos_));
+              auto same = detail::common_prefix (reader1.pos_, reader2.pos_,
+                                                 size);
+              reader1.pos_ += same;
+              reader2.pos_ += same;
+
+              bool differ = same < size;
+              if (!differ)
+                {
+                  bool ended1 = reader1.word_ended ();
+                  bool ended2 = reader2.word_ended ();
+                  if (ended1 && ended2)
+                    break;
+                  differ = ended1 || ended2;
+                }
+
+              if (differ)
+                {
+                  auto offset1 = reader1.pos_ - reader1.mark_;
+                  auto offset2 = reader2.pos_ - reader2.mark_;
+                  reader1.complete_word ();
+                  reader2.complete_word ();
+                  auto tok1 = reader1.make_token (type1);
+                  auto tok2 = reader2.make_token (type2);
+
+                  // Words truncated by the buffer, at either end, are never
+                  // numbers.
+                  std::optional<double> difference;
+                  if (tolerance && !reader1.truncated_ && !reader2.truncated_
+                      && (reader1.pos_ != reader1.end_ || reader1.eof_)
+                      && (reader2.pos_ != reader2.end_ || reader2.eof_))
+                    {
+                      bool accepted;
+                      std::tie (accepted, difference)
+                          = compare_numbers (*tolerance, tok1, tok2);
+                      if (accepted)
+                        break;
+                    }
+
+                  return {{line_number,
+                           {{reader1.mark_ + offset1,
+                             reader2.mark_ + offset2}},
+                           tok1, tok2, difference}};
+                }
+            }
+        }
+    }
+
+  return {};
+}
+}
+
+/**
+ * Compare two streams, returning the mismatch or none if they are
+ * equivalent.
+ *
+ * The result is the same as that of comparing the whole inputs, except that
+ * the reported tokens are truncated to what fits in the buffers. They point
+ * into the buffers of the readers, so they are valid until the readers are
+ * used again or destroyed.
+ *
+ * @param reader1 first input
+ * @param reader2 second input
+ * @return mismatch or none
+ */
+template <stream_source Source1, stream_source Source2>
+std::optional<mismatch<const char *, const char *>>
+compare (stream_reader<Source1> &reader1, stream_reader<Source2> &reader2)
+{
+  no_counters counters;
+  return detail::compare_streams (reader1, reader2, nullptr, counters);
+}
+
+/**
+ * Compare two streams, comparing words which are numbers with a tolerance.
+ *
+ * @param reader1 first input
+ * @param reader2 second input
+ * @param tolerance tolerance of numbers
+ * @return mismatch or none
+ */
+template <stream_source Source1, stream_source Source2>
+std::optional<mismatch<const char *, const char *>>
+compare (stream_reader<Source1> &reader1, stream_reader<Source2> &reader2,
+         const tolerance &tolerance)
+{
+  no_counters counters;
+  return detail::compare_streams (reader1, reader2, &tolerance, counters);
+}
+}
+
+#endif /* __OICOMPARE_STREAM_HH__ */
\ No newline at end of file
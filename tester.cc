@@ -1,17 +1,51 @@
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <cerrno>
 #include <cmath>
 #include <cstddef>
 #include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <list>
 #include <optional>
 #include <string>
 #include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
 #include <variant>
+#include <vector>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 #include <fmt/format.h>
+#ifdef OICOMPARE_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef OICOMPARE_HAVE_ZSTD
+#include <zstd.h>
+#endif
 
+#include "alternatives.hh"
+#include "batch.hh"
+#include "compiled.hh"
+#include "compressed.hh"
+#include "digest.hh"
+#include "hash.hh"
+#include "incremental.hh"
+#include "io.hh"
 #include "oicompare.hh"
+#include "parallel.hh"
+#include "service.hh"
+#include "stream.hh"
 #include "tests.hh"
+#include "unordered.hh"
+#include "uring.hh"
+#include "window.hh"
 
 using namespace oicompare::tests;
 
@@ -49,10 +83,1247 @@ test_constexpr ()
 
 // Run tests in compile time.
 static_assert (test_constexpr ());
+
+template <typename Policy, std::size_t N>
+constexpr bool
+test_policy (const std::array<test_case, N> &test_cases)
+{
+  for (const auto &test_case : test_cases)
+    {
+      auto result
+          = oicompare::compare<Policy> (test_case.first, test_case.second);
+      if (!compare_result (test_case.first.begin (),
+                           test_case.second.begin (),
+                           test_case.expected_result, result))
+        return false;
+
+      // Test symmetry
+      auto expected = test_case.expected_result;
+      expected.swap ();
+      result = oicompare::compare<Policy> (test_case.second, test_case.first);
+      if (!compare_result (test_case.second.begin (),
+                           test_case.first.begin (), expected, result))
+        return false;
+    }
+
+  return true;
+}
+
+static_assert (test_policy<oicompare::ignore_whitespace_policy> (
+    ignore_whitespace_test_cases));
+static_assert (test_policy<oicompare::ignore_blank_lines_policy> (
+    ignore_blank_lines_test_cases));
+static_assert (test_policy<oicompare::strict_whitespace_policy> (
+    strict_whitespace_test_cases));
+static_assert (test_policy<oicompare::case_insensitive_policy> (
+    case_insensitive_test_cases));
+static_assert (test_policy<oicompare::integer_policy> (integer_test_cases));
+
+/**
+ * A stream source returning chunks of at most the given size.
+ */
+struct memory_source
+{
+  std::string_view data;
+  std::size_t chunk_size;
+
+  std::size_t
+  read (char *buffer, std::size_t size)
+  {
+    auto count = std::min ({size, chunk_size, data.size ()});
+    std::memcpy (buffer, data.data (), count);
+    data.remove_prefix (count);
+    return count;
+  }
+};
+
+bool
+test_stream (const test_case &test_case, std::size_t chunk_size,
+             std::size_t buffer_size)
+{
+  // Tokens fit in the buffer, so they should be reported in full.
+  bool exact = buffer_size >= 1024;
+
+  {
+    oicompare::stream_reader reader1{
+        memory_source{test_case.first, chunk_size}, buffer_size};
+    oicompare::stream_reader reader2{
+        memory_source{test_case.second, chunk_size}, buffer_size};
+    auto result = oicompare::compare (reader1, reader2);
+
+    if (!compare_stream_result (test_case.first, test_case.second,
+                                test_case.expected_result, result, exact))
+      return false;
+  }
+
+  // Test symmetry
+  {
+    oicompare::stream_reader reader1{
+        memory_source{test_case.second, chunk_size}, buffer_size};
+    oicompare::stream_reader reader2{
+        memory_source{test_case.first, chunk_size}, buffer_size};
+    auto result = oicompare::compare (reader1, reader2);
+
+    auto expected = test_case.expected_result;
+    expected.swap ();
+
+    if (!compare_stream_result (test_case.second, test_case.first, expected,
+                                result, exact))
+      return false;
+  }
+
+  return true;
+}
+
+/**
+ * Feeds two inputs to an incremental comparator in chunks, all of the first
+ * input before the second, or the other way round, or alternating.
+ */
+bool
+test_incremental (std::string_view first, std::string_view second,
+                  const result &expected,
+                  const std::optional<oicompare::tolerance> &tolerance
+                  = std::nullopt)
+{
+  for (std::size_t chunk_size : {1, 3, 4096})
+    for (int order : {0, 1, 2})
+      {
+        auto comparator = tolerance
+                              ? oicompare::incremental_comparator{*tolerance}
+                              : oicompare::incremental_comparator{};
+        std::size_t pos1 = 0, pos2 = 0;
+        bool finished1 = false, finished2 = false;
+        auto feed1 = [&] {
+          auto size = std::min (chunk_size, first.size () - pos1);
+          comparator.feed_first ({first.data () + pos1, size});
+          if ((pos1 += size) == first.size ())
+            {
+              comparator.finish_first ();
+              finished1 = true;
+            }
+        };
+        auto feed2 = [&] {
+          auto size = std::min (chunk_size, second.size () - pos2);
+          comparator.feed_second ({second.data () + pos2, size});
+          if ((pos2 += size) == second.size ())
+            {
+              comparator.finish_second ();
+              finished2 = true;
+            }
+        };
+
+        // Feeding stops once the result is known.
+        while (!comparator.done ())
+          if (!finished1
+              && (finished2 || order == 0 || (order == 2 && pos1 <= pos2)))
+            feed1 ();
+          else
+            feed2 ();
+
+        if (!compare_stream_result (first, second, expected,
+                                    comparator.result (), true))
+          return false;
+      }
+
+  // Only the lead of an input over the other is kept.
+  oicompare::incremental_comparator ahead;
+  ahead.feed_first (std::string_view{"1 2 3 4"});
+  auto lead = ahead.buffered ();
+  ahead.feed_second (std::string_view{"1 2 "});
+  if (lead != 7 || ahead.buffered () != 3)
+    return false;
+
+  // Differing words are a mismatch before they end.
+  oicompare::incremental_comparator comparator;
+  comparator.feed_first (std::string_view{"1 23"});
+  return !comparator.feed_second (std::string_view{"1 24"});
+}
+
+bool
+test_compiled (std::string_view first, std::string_view second,
+               const result &expected)
+{
+  // A small stride, so that the line index is used.
+  auto data = oicompare::compile (first.data (), first.data () + first.size (),
+                                  2);
+  oicompare::compiled_expected compiled{data};
+  auto result = oicompare::compare (compiled, second.data (),
+                                    second.data () + second.size ());
+  if (!compare_stream_result (first, second, expected, result, true))
+    return false;
+
+  // Equivalent outputs have the same canonical hash, which is the digest.
+  auto other = oicompare::compile (second.data (),
+                                   second.data () + second.size ());
+  bool equivalent = std::holds_alternative<success> (expected);
+  return equivalent
+             == (oicompare::compiled_expected{other}.hash ()
+                 == compiled.hash ())
+         && oicompare::digest (first) == compiled.hash ()
+         && oicompare::digest (second)
+                == oicompare::compiled_expected{other}.hash ();
+}
+
+bool
+test_tolerance (const test_tolerance_case &test_case)
+{
+  auto first = test_case.first;
+  auto second = test_case.second;
+  const auto &expected = test_case.expected_result;
+
+  auto result = oicompare::compare (first, second, test_case.tolerance);
+  if (!compare_result (first.begin (), second.begin (), expected, result))
+    return false;
+
+  for (std::size_t chunk_size : {1, 4096})
+    {
+      oicompare::stream_reader reader1{memory_source{first, chunk_size}};
+      oicompare::stream_reader reader2{memory_source{second, chunk_size}};
+      auto result = oicompare::compare (reader1, reader2, test_case.tolerance);
+      if (!compare_stream_result (first, second, expected, result, true))
+        return false;
+    }
+
+  auto data = oicompare::compile (first.data (), first.data () + first.size (),
+                                  2);
+  oicompare::compiled_expected compiled{data};
+  if (!compare_stream_result (
+          first, second, expected,
+          oicompare::compare (compiled, second.data (),
+                              second.data () + second.size (),
+                              test_case.tolerance),
+          true))
+    return false;
+
+  oicompare::thread_pool pool{2};
+  for (std::size_t block_size : {1, 3, 64})
+    if (!compare_result (first.data (), second.data (), expected,
+                         oicompare::compare_parallel (first, second, pool,
+                                                      test_case.tolerance,
+                                                      block_size)))
+      return false;
+
+  return test_incremental (first, second, expected, test_case.tolerance);
+}
+
+/**
+ * Checks the hasher against reference digests, with the data split in two at
+ * every position.
+ */
+bool
+test_hash (const test_hash_case &test_case)
+{
+  const auto &data = test_case.data;
+  for (std::size_t split = 0; split <= data.size (); ++split)
+    {
+      oicompare::hasher hasher;
+      hasher.update (data.data (), split);
+      hasher.update (data.data () + split, data.size () - split);
+      if (hasher.finish ()
+          != oicompare::hash128{test_case.low, test_case.high})
+        return false;
+    }
+  return true;
+}
+
+/**
+ * Checks that words truncated by the buffer of a stream, at either end, are
+ * never compared as numbers.
+ */
+bool
+test_truncated_numbers ()
+{
+  // Only the last digits of the words are left in a small buffer.
+  auto first = "1" + std::string (400, '0') + "1";
+  auto second = "1" + std::string (400, '0') + "2";
+  for (std::size_t chunk_size : {1, 4096})
+    {
+      oicompare::stream_reader reader1{memory_source{first, chunk_size}, 64};
+      oicompare::stream_reader reader2{memory_source{second, chunk_size}, 64};
+      auto result = oicompare::compare (reader1, reader2,
+                                        oicompare::tolerance{2, 0});
+      if (!result || result->numeric_difference)
+        return false;
+    }
+  return true;
+}
+
+/**
+ * Checks the counters of the work done by a comparison, which do not change
+ * its result.
+ */
+bool
+test_counters ()
+{
+  using pair = std::array<std::size_t, 2>;
+  auto first = "1 2\n3\n"sv, second = "1 2\n4\n"sv;
+
+  // The common prefix of contiguous inputs is skipped.
+  oicompare::counters counters;
+  auto result = oicompare::compare (first.begin (), first.end (),
+                                    second.begin (), second.end (), counters);
+  if (!result || counters.skipped != 4 || counters.tokens != pair{1, 1}
+      || counters.newlines != pair{0, 0})
+    return false;
+
+  // Other inputs are tokenized from their beginning.
+  std::list<char> list1 (first.begin (), first.end ());
+  std::list<char> list2 (second.begin (), second.end ());
+  counters = {};
+  oicompare::tolerance tolerance{2, 0};
+  auto list_result
+      = oicompare::compare (list1.begin (), list1.end (), list2.begin (),
+                            list2.end (), tolerance, counters);
+  if (list_result || counters.skipped != 0 || counters.tokens != pair{5, 5}
+      || counters.newlines != pair{2, 2})
+    return false;
+
+  auto directory = std::filesystem::temp_directory_path ();
+  auto suffix = fmt::format ("oicompare-tester-{}", ::getpid ());
+  auto first_path = directory / (suffix + "-1.txt");
+  auto second_path = directory / (suffix + "-2.txt");
+  oicompare::io::write_file (first_path.c_str (), first);
+  oicompare::io::write_file (second_path.c_str (), second);
+
+  fmt::memory_buffer buffer;
+  oicompare::io::statistics stats;
+  int status = oicompare::io::compare_files (
+      first_path.c_str (), second_path.c_str (),
+      oicompare::translations::english_translation<
+          oicompare::translations::kind::terse>::format,
+      buffer, {}, nullptr, &stats);
+  std::filesystem::remove (first_path);
+  std::filesystem::remove (second_path);
+  if (status != 1 || stats.bytes != pair{6, 6} || stats.counters.skipped != 4
+      || stats.counters.tokens != pair{1, 1})
+    return false;
+
+  // Pipes are compared as streams.
+  int pipe1[2], pipe2[2];
+  if (::pipe (pipe1) != 0 || ::pipe (pipe2) != 0)
+    throw std::system_error{errno, std::generic_category (), "pipe"};
+  static_cast<void> (::write (pipe1[1], "a b", 3));
+  static_cast<void> (::write (pipe2[1], "a  b\n\n", 6));
+  ::close (pipe1[1]);
+  ::close (pipe2[1]);
+  stats = {};
+  status = oicompare::io::compare_fds (
+      pipe1[0], pipe2[0],
+      oicompare::translations::english_translation<
+          oicompare::translations::kind::terse>::format,
+      buffer, {}, nullptr, &stats);
+  ::close (pipe1[0]);
+  ::close (pipe2[0]);
+  return status == 0 && stats.bytes == pair{3, 6}
+         && stats.counters.tokens == pair{2, 4}
+         && stats.counters.newlines == pair{0, 2};
+}
+
+/**
+ * Checks the byte offsets of the mismatched tokens of files and pipes, as
+ * reported in JSON.
+ */
+bool
+test_offsets ()
+{
+  auto directory = std::filesystem::temp_directory_path ();
+  auto suffix = fmt::format ("oicompare-tester-{}", ::getpid ());
+  auto first_path = directory / (suffix + "-1.txt");
+  auto second_path = directory / (suffix + "-2.txt");
+  oicompare::io::write_file (first_path.c_str (), "1 2\n3  4\n");
+  oicompare::io::write_file (second_path.c_str (), "1 2\n3 5\n");
+
+  auto *format = oicompare::translations::json_translation::format;
+  auto offsets = [] (const fmt::memory_buffer &buffer) {
+    auto json = fmt::to_string (buffer);
+    std::string found;
+    for (auto pos = json.find ("\"offset\":"); pos != std::string::npos;
+         pos = json.find ("\"offset\":", pos + 1))
+      found += json.substr (pos + 9, json.find (',', pos) - pos - 9) + ' ';
+    return found;
+  };
+
+  fmt::memory_buffer buffer;
+  oicompare::io::compare_files (first_path.c_str (), second_path.c_str (),
+                                format, buffer);
+  bool ok = offsets (buffer) == "7 6 ";
+
+  int pipe1[2], pipe2[2];
+  if (::pipe (pipe1) != 0 || ::pipe (pipe2) != 0)
+    throw std::system_error{errno, std::generic_category (), "pipe"};
+  static_cast<void> (::write (pipe1[1], "1 2\n3  4\n", 9));
+  static_cast<void> (::write (pipe2[1], "1 2\n3 5\n", 8));
+  ::close (pipe1[1]);
+  ::close (pipe2[1]);
+  buffer.clear ();
+  oicompare::io::compare_fds (pipe1[0], pipe2[0], format, buffer);
+  ::close (pipe1[0]);
+  ::close (pipe2[0]);
+  ok = ok && offsets (buffer) == "7 6 ";
+
+  // The tokens of a compiled expected output are not in the original.
+  std::string_view original{"1 2\n3  4\n"};
+  oicompare::io::write_file (
+      first_path.c_str (),
+      oicompare::compile (original.data (),
+                          original.data () + original.size ()));
+  buffer.clear ();
+  oicompare::io::compare_files (first_path.c_str (), second_path.c_str (),
+                                format, buffer);
+  ok = ok && offsets (buffer) == "null 6 ";
+
+  std::filesystem::remove (first_path);
+  std::filesystem::remove (second_path);
+  return ok;
+}
+
+/**
+ * Checks that the comparison goes on after mismatches at the next line of
+ * both inputs, for strings, files and pipes.
+ */
+bool
+test_max_mismatches ()
+{
+  auto first = "1\n2\n3\n4 5\n6\n"sv;
+  auto second = "1\n0\n3\n4 6 7\n6\nextra\nmore\n"sv;
+  std::vector<oicompare::mismatch<const char *, const char *>> mismatches;
+  auto lines = oicompare::compare_all (
+      first.data (), first.data () + first.size (), second.data (),
+      second.data () + second.size (), 2, mismatches);
+  if (lines != 4 || mismatches.size () != 2
+      || mismatches[0].line_number != 2 || mismatches[1].line_number != 4
+      || std::string_view{mismatches[1].second.first,
+                          mismatches[1].second.last}
+             != "6"sv)
+    return false;
+
+  // The numbers of the first line are accepted.
+  auto reals1 = "1.0\n2.0\n"sv, reals2 = "1.05\n3\n"sv;
+  mismatches.clear ();
+  lines = oicompare::compare_all (
+      reals1.data (), reals1.data () + reals1.size (), reals2.data (),
+      reals2.data () + reals2.size (), oicompare::tolerance{0.1, 0}, 5,
+      mismatches);
+  if (lines != 1 || mismatches.size () != 1
+      || mismatches[0].line_number != 2)
+    return false;
+
+  // The long trailing whitespace is found once, not for every mismatch.
+  std::string wrong1, wrong2;
+  for (std::size_t i = 0; i < 20000; ++i)
+    {
+      wrong1 += "1\n";
+      wrong2 += "2\n";
+    }
+  wrong2.append (std::size_t{16} << 20, '\n');
+  mismatches.clear ();
+  lines = oicompare::compare_all (
+      wrong1.data (), wrong1.data () + wrong1.size (), wrong2.data (),
+      wrong2.data () + wrong2.size (), 1, mismatches);
+  if (lines != 20000 || mismatches.size () != 1
+      || mismatches[0].line_number != 1)
+    return false;
+
+  auto directory = std::filesystem::temp_directory_path ();
+  auto suffix = fmt::format ("oicompare-tester-{}", ::getpid ());
+  auto first_path = directory / (suffix + "-1.txt");
+  auto second_path = directory / (suffix + "-2.txt");
+  oicompare::io::write_file (first_path.c_str (), first);
+  oicompare::io::write_file (second_path.c_str (), second);
+
+  oicompare::io::options options;
+  options.max_mismatches = 2;
+  fmt::memory_buffer buffer;
+  int status = oicompare::io::compare_files (
+      first_path.c_str (), second_path.c_str (),
+      oicompare::translations::english_translation<
+          oicompare::translations::kind::full>::format,
+      buffer, options);
+  bool ok = status == 1
+            && fmt::to_string (buffer)
+                   == "WRONG: line 2: expected \"2\", got \"0\"\n"
+                      "WRONG: line 4: expected \"5\", got \"6\"\n"
+                      "Mismatched lines: 4\n";
+
+  buffer.clear ();
+  status = oicompare::io::compare_files (
+      first_path.c_str (), first_path.c_str (),
+      oicompare::translations::english_translation<
+          oicompare::translations::kind::full>::format,
+      buffer, options);
+  ok = ok && status == 0 && fmt::to_string (buffer) == "OK\n";
+
+  // Pipes are read whole.
+  int pipe2[2];
+  if (::pipe (pipe2) != 0)
+    throw std::system_error{errno, std::generic_category (), "pipe"};
+  static_cast<void> (::write (pipe2[1], second.data (), second.size ()));
+  ::close (pipe2[1]);
+  auto fd1 = ::open (first_path.c_str (), O_RDONLY);
+  options.max_mismatches = 1;
+  options.format_count = oicompare::translations::parse_count ("json");
+  buffer.clear ();
+  status = oicompare::io::compare_fds (
+      fd1, pipe2[0], oicompare::translations::json_translation::format,
+      buffer, options);
+  ::close (fd1);
+  ::close (pipe2[0]);
+  auto json = fmt::to_string (buffer);
+  ok = ok && status == 1
+       && json.starts_with ("{\"verdict\":\"WRONG\",\"line\":2,")
+       && json.ends_with ("}\n{\"mismatched_lines\":4}\n");
+
+  std::filesystem::remove (first_path);
+  std::filesystem::remove (second_path);
+  return ok;
+}
+
+/**
+ * Checks an unordered comparison both ways, in memory and partitioned.
+ */
+bool
+test_unordered (const test_case &test_case, oicompare::unordered_unit unit)
+{
+  auto expected = test_case.expected_result;
+  expected.swap ();
+  for (std::size_t memory_limit :
+       {oicompare::default_unordered_memory_limit, std::size_t{0}})
+    {
+      auto result = oicompare::compare_unordered (
+          test_case.first.data (),
+          test_case.first.data () + test_case.first.size (),
+          test_case.second.data (),
+          test_case.second.data () + test_case.second.size (), unit,
+          memory_limit);
+      if (!compare_result (test_case.first.data (), test_case.second.data (),
+                           test_case.expected_result, result))
+        return false;
+
+      result = oicompare::compare_unordered (
+          test_case.second.data (),
+          test_case.second.data () + test_case.second.size (),
+          test_case.first.data (),
+          test_case.first.data () + test_case.first.size (), unit,
+          memory_limit);
+      if (!compare_result (test_case.second.data (), test_case.first.data (),
+                           expected, result))
+        return false;
+    }
+  return true;
+}
+
+/**
+ * Checks that a comparison with a single alternative is the same as by
+ * compare(), and that the received output matches itself as the second
+ * alternative unless the first one matches too.
+ */
+template <typename Policy, std::size_t N>
+bool
+test_alternatives (const std::array<test_case, N> &test_cases)
+{
+  for (const auto &test_case : test_cases)
+    {
+      const std::string_view single[] = {test_case.first};
+      auto result = oicompare::compare_alternatives<Policy> (
+          single, test_case.second);
+      if (result.alternative != 0
+          || !compare_result (test_case.first.data (),
+                              test_case.second.data (),
+                              test_case.expected_result, result.mismatch))
+        return false;
+
+      const std::string_view both[] = {test_case.first, test_case.second};
+      result = oicompare::compare_alternatives<Policy> (both,
+                                                        test_case.second);
+      std::size_t alternative
+          = std::holds_alternative<success> (test_case.expected_result) ? 0
+                                                                         : 1;
+      if (result.alternative != alternative || result.mismatch)
+        return false;
+    }
+  return true;
+}
+
+/**
+ * Checks which alternative is chosen, and that files are compared with
+ * alternatives.
+ */
+bool
+test_alternative_files ()
+{
+  for (const auto &test_case : alternatives_test_cases)
+    {
+      auto result = oicompare::compare_alternatives (test_case.expected,
+                                                     test_case.received);
+      const auto &expected = test_case.expected[test_case.alternative];
+      if (result.alternative != test_case.alternative
+          || !compare_result (expected.data (), test_case.received.data (),
+                              test_case.expected_result, result.mismatch))
+        return false;
+    }
+
+  auto directory = std::filesystem::temp_directory_path ()
+                   / fmt::format ("oicompare-alternatives-{}", ::getpid ());
+  std::filesystem::create_directories (directory);
+  auto write = [&] (const char *name, std::string_view contents) {
+    auto path = directory / name;
+    oicompare::io::write_file (path.c_str (), contents);
+    return path;
+  };
+  auto received = write ("received", "1 2\n3 4\n");
+  auto first = write ("first", "1 2\n3 5\n");
+  auto second = write ("second", "1 2\n3");
+  auto third = write ("third", "1 2 3 4");
+  auto plain = "1  2\n3 4"sv;
+  auto compiled = write (
+      "compiled", oicompare::compile (plain.data (),
+                                      plain.data () + plain.size ()));
+
+  auto compare = [&] (std::initializer_list<const char *> paths,
+                      const oicompare::io::options &options = {}) {
+    fmt::memory_buffer buffer;
+    int status = oicompare::io::compare_alternative_files (
+        received.c_str (), {paths.begin (), paths.size ()},
+        oicompare::translations::english_translation<
+            oicompare::translations::kind::full>::format,
+        buffer, options);
+    return fmt::format ("{} {}", status, fmt::to_string (buffer));
+  };
+
+  oicompare::io::options ignore_whitespace;
+  ignore_whitespace.mode = oicompare::io::comparison_mode::ignore_whitespace;
+  bool passed
+      = compare ({first.c_str (), second.c_str ()})
+            == "1 WRONG: line 2: expected \"5\", got \"4\"\n"
+        && compare ({first.c_str (), compiled.c_str ()}) == "0 OK\n"
+        && compare ({third.c_str (), first.c_str ()})
+               == "1 WRONG: line 2: expected \"5\", got \"4\"\n"
+        && compare ({first.c_str (), third.c_str ()}, ignore_whitespace)
+               == "0 OK\n";
+
+  std::filesystem::remove_all (directory);
+  return passed;
+}
+
+/**
+ * Checks that the pairs of a manifest are reported in its order, with the
+ * largest exit code, and that invalid manifests are rejected.
+ */
+bool
+test_batch ()
+{
+  auto directory = std::filesystem::temp_directory_path ()
+                   / fmt::format ("oicompare-batch-{}", ::getpid ());
+  std::filesystem::create_directories (directory);
+  auto write = [&] (const char *name, std::string_view contents) {
+    auto path = directory / name;
+    oicompare::io::write_file (path.c_str (), contents);
+    return path;
+  };
+  auto expected = write ("expected", "1 2\n");
+  auto same = write ("same", "1  2");
+  auto wrong = write ("wrong", "1 3\n");
+  auto missing = directory / "missing";
+
+  auto manifest = write (
+      "manifest",
+      fmt::format ("{0} {1} english_abbreviated\n{0}\t{2}\n\n{0} {3}\n",
+                   expected.native (), wrong.native (), missing.native (),
+                   same.native ()));
+  auto invalid = write ("invalid", fmt::format ("{} {} klingon_full\n",
+                                                expected.native (),
+                                                same.native ()));
+
+  fmt::memory_buffer buffer;
+  int status = oicompare::io::compare_batch (manifest.c_str (), buffer, {}, 2);
+  bool passed
+      = status == 2
+        && fmt::to_string (buffer)
+               == fmt::format ("1 WRONG: line 1: expected \"2\", got \"3\"\n"
+                               "2 {}: No such file or directory\n"
+                               "0 OK\n",
+                               missing.native ());
+
+  try
+    {
+      buffer.clear ();
+      oicompare::io::compare_batch (invalid.c_str (), buffer);
+      passed = false;
+    }
+  catch (const std::runtime_error &e)
+    {
+      passed = passed
+               && e.what ()
+                      == fmt::format ("{}:1: Unknown translation: "
+                                      "klingon_full",
+                                      invalid.native ());
+    }
+
+  std::filesystem::remove_all (directory);
+  return passed;
+}
+
+/**
+ * Checks that many lines are compared the same way whether the table fits
+ * in memory or not, and that files are compared unordered.
+ */
+bool
+test_unordered_files ()
+{
+  std::string first, second;
+  for (std::size_t i = 0; i < 20000; ++i)
+    {
+      first += fmt::format ("{} {}\n", i % 1000, i);
+      second += fmt::format ("{}  {}\n", (19999 - i) % 1000, 19999 - i);
+    }
+
+  auto compare = [&] (std::string_view second, std::size_t memory_limit) {
+    return oicompare::compare_unordered (
+        first.data (), first.data () + first.size (), second.data (),
+        second.data () + second.size (), oicompare::unordered_unit::lines,
+        memory_limit);
+  };
+  if (compare (second, 0)
+      || compare (second, oicompare::default_unordered_memory_limit))
+    return false;
+
+  auto changed = second;
+  changed.replace (changed.find ("\n12 ") + 1, 2, "13");
+  for (std::size_t memory_limit :
+       {std::size_t{0}, oicompare::default_unordered_memory_limit})
+    {
+      auto result = compare (changed, memory_limit);
+      if (!result || result->line_number != 19013
+          || std::string_view{result->first.first, result->first.last}
+                 != "12 19012"sv
+          || std::string_view{result->second.first, result->second.last}
+                 != "13  19012"sv)
+        return false;
+    }
+
+  // Partitions which do not fit either are split again.
+  auto split = oicompare::detail::compare_partitioned (
+                   first.data (), first.data () + first.size (),
+                   changed.data (), changed.data () + changed.size (),
+                   oicompare::unordered_unit::lines, 2, 0)
+                   .result (first.data () + first.size (),
+                            changed.data () + changed.size ());
+  if (!split || split->line_number != 19013
+      || std::string_view{split->second.first, split->second.last}
+             != "13  19012"sv)
+    return false;
+
+  auto directory = std::filesystem::temp_directory_path ();
+  auto suffix = fmt::format ("oicompare-tester-{}", ::getpid ());
+  auto first_path = directory / (suffix + "-1.txt");
+  auto second_path = directory / (suffix + "-2.txt");
+  oicompare::io::write_file (first_path.c_str (), first);
+  oicompare::io::write_file (second_path.c_str (), second);
+
+  oicompare::io::options options;
+  options.unordered = oicompare::unordered_unit::tokens;
+  fmt::memory_buffer buffer;
+  int status = oicompare::io::compare_files (
+      first_path.c_str (), second_path.c_str (),
+      oicompare::translations::json_translation::format, buffer, options);
+  std::filesystem::remove (first_path);
+  std::filesystem::remove (second_path);
+  return status == 0
+         && fmt::to_string (buffer) == "{\"verdict\":\"OK\"}\n";
+}
+
+/**
+ * Checks that files are brought into memory the same way by every strategy.
+ */
+bool
+test_read_strategies ()
+{
+  auto path = std::filesystem::temp_directory_path ()
+              / fmt::format ("oicompare-tester-{}.txt", ::getpid ());
+  bool ok = true;
+  for (auto size : {std::size_t{0}, std::size_t{5},
+                    oicompare::io::mapped_file::small_size + 1})
+    {
+      std::string contents (size, 'x');
+      oicompare::io::write_file (path.c_str (), contents);
+      for (auto strategy :
+           {oicompare::io::read_strategy::automatic,
+            oicompare::io::read_strategy::read,
+            oicompare::io::read_strategy::mmap,
+            oicompare::io::read_strategy::populate})
+        ok = ok
+             && oicompare::io::mapped_file{path, strategy}.contents ()
+                    == contents;
+    }
+  std::filesystem::remove (path);
+  return ok;
+}
+
+/**
+ * Compares the test cases written to files, read ahead in chunks.
+ */
+bool
+test_uring ()
+{
+  auto directory = std::filesystem::temp_directory_path ();
+  auto suffix = fmt::format ("oicompare-tester-{}", ::getpid ());
+  auto first_path = directory / (suffix + "-1.txt");
+  auto second_path = directory / (suffix + "-2.txt");
+
+  bool ok = true;
+  for (const auto &test_case : test_cases)
+    {
+      oicompare::io::write_file (first_path.c_str (), test_case.first);
+      oicompare::io::write_file (second_path.c_str (), test_case.second);
+      oicompare::fd_source file1{first_path.c_str ()};
+      oicompare::fd_source file2{second_path.c_str ()};
+
+      for (std::size_t chunk_size : {1, 5, 4096})
+        for (std::size_t depth : {1, 3})
+          {
+            oicompare::stream_reader reader1{oicompare::uring_source{
+                file1.fd (), test_case.first.size (), chunk_size, depth}};
+            oicompare::stream_reader reader2{oicompare::uring_source{
+                file2.fd (), test_case.second.size (), chunk_size, depth}};
+            ok = ok
+                 && compare_stream_result (
+                     test_case.first, test_case.second,
+                     test_case.expected_result,
+                     oicompare::compare (reader1, reader2), true);
+          }
+    }
+
+  std::filesystem::remove (first_path);
+  std::filesystem::remove (second_path);
+  return ok;
+}
+
+/**
+ * Compares the test cases and a file of several pages written to files, read
+ * through sliding windows.
+ */
+bool
+test_window ()
+{
+  auto directory = std::filesystem::temp_directory_path ();
+  auto suffix = fmt::format ("oicompare-tester-{}", ::getpid ());
+  auto first_path = directory / (suffix + "-1.txt");
+  auto second_path = directory / (suffix + "-2.txt");
+
+  std::string lines1, lines2;
+  for (std::size_t i = 0; i < 20000; ++i)
+    {
+      lines1 += fmt::format ("{}\n", i);
+      lines2 += fmt::format ("{}\n", i == 19000 ? 0 : i);
+    }
+  std::vector<test_case> cases (test_cases.begin (), test_cases.end ());
+  using oicompare::token_type;
+
+  // Words longer than the buffer of a stream_reader are reported in full.
+  auto word1 = "1 " + std::string (300000, 'a') + "\n";
+  auto word2 = "1 " + std::string (299999, 'a') + "b\n";
+  cases.push_back (test_case{{failure{1, {token_type::word, 2, 300002},
+                                      {token_type::word, 2, 300002}}},
+                             word1, word2});
+  cases.push_back (test_case{{failure{19001,
+                                      {token_type::word, 102890, 102895},
+                                      {token_type::word, 102890, 102891}}},
+                             lines1, lines2});
+
+  bool ok = true;
+  for (const auto &test_case : cases)
+    {
+      oicompare::io::write_file (first_path.c_str (), test_case.first);
+      oicompare::io::write_file (second_path.c_str (), test_case.second);
+      oicompare::fd_source file1{first_path.c_str ()};
+      oicompare::fd_source file2{second_path.c_str ()};
+
+      // Words are only truncated if they are longer than the window.
+      for (std::size_t window_size : {1, 10000, 1 << 20})
+        {
+          oicompare::stream_reader reader1{oicompare::window_source{
+              file1.fd (), test_case.first.size (), window_size}};
+          oicompare::stream_reader reader2{oicompare::window_source{
+              file2.fd (), test_case.second.size (), window_size}};
+          ok = ok
+               && compare_stream_result (
+                   test_case.first, test_case.second,
+                   test_case.expected_result,
+                   oicompare::compare (reader1, reader2),
+                   window_size >= 1 << 20 || test_case.first != word1);
+        }
+    }
+
+  // The large files are read through windows when asked to.
+  oicompare::io::options options;
+  options.io = oicompare::io::read_strategy::window;
+  fmt::memory_buffer buffer;
+  int status = oicompare::io::compare_files (
+      first_path.c_str (), second_path.c_str (),
+      oicompare::translations::json_translation::format, buffer, options);
+  ok = ok && status == 1
+       && fmt::to_string (buffer).find ("\"offset\":102890")
+              != std::string::npos;
+
+  std::filesystem::remove (first_path);
+  std::filesystem::remove (second_path);
+  return ok;
+}
+
+#ifdef OICOMPARE_HAVE_ZLIB
+std::string
+compress_gzip (std::string_view data)
+{
+  z_stream stream{};
+  if (::deflateInit2 (&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                      Z_DEFAULT_STRATEGY)
+      != Z_OK)
+    throw std::runtime_error{"deflateInit2"};
+  std::string out (::deflateBound (&stream, data.size ()), '\0');
+  stream.next_in
+      = reinterpret_cast<Bytef *> (const_cast<char *> (data.data ()));
+  stream.avail_in = static_cast<uInt> (data.size ());
+  stream.next_out = reinterpret_cast<Bytef *> (out.data ());
+  stream.avail_out = static_cast<uInt> (out.size ());
+  ::deflate (&stream, Z_FINISH);
+  out.resize (stream.total_out);
+  ::deflateEnd (&stream);
+  return out;
+}
+#endif
+
+#ifdef OICOMPARE_HAVE_ZSTD
+std::string
+compress_zstd (std::string_view data)
+{
+  std::string out (::ZSTD_compressBound (data.size ()), '\0');
+  out.resize (::ZSTD_compress (out.data (), out.size (), data.data (),
+                              data.size (), 3));
+  return out;
+}
+#endif
+
+/**
+ * Compares the test cases with the first input compressed in two members or
+ * frames, decompressed in chunks.
+ */
+bool
+test_compressed ()
+{
+  std::vector<std::pair<oicompare::compression,
+                        std::string (*) (std::string_view)>>
+      formats;
+#ifdef OICOMPARE_HAVE_ZLIB
+  formats.emplace_back (oicompare::compression::gzip, compress_gzip);
+#endif
+#ifdef OICOMPARE_HAVE_ZSTD
+  formats.emplace_back (oicompare::compression::zstd, compress_zstd);
+#endif
+
+  auto directory = std::filesystem::temp_directory_path ();
+  auto suffix = fmt::format ("oicompare-tester-{}", ::getpid ());
+  auto first_path = directory / (suffix + "-1.txt");
+  auto second_path = directory / (suffix + "-2.txt");
+  auto plain_path = directory / (suffix + "-3.txt");
+
+  bool ok = true;
+  for (const auto &[format, compress] : formats)
+    {
+      for (const auto &test_case : test_cases)
+        {
+          auto half = test_case.first.size () / 2;
+          auto compressed = compress (test_case.first.substr (0, half))
+                            + compress (test_case.first.substr (half));
+          oicompare::io::write_file (first_path.c_str (), compressed);
+          oicompare::io::write_file (second_path.c_str (), test_case.second);
+          ok = ok && oicompare::detect_compression (compressed) == format;
+
+          oicompare::fd_source file{first_path.c_str ()};
+          for (std::size_t chunk_size : {1, 5, 4096})
+            for (std::size_t depth : {1, 3})
+              {
+                ::lseek (file.fd (), 0, SEEK_SET);
+                oicompare::stream_reader reader1{
+                    oicompare::decompressing_source{file.fd (), format,
+                                                    chunk_size, depth}};
+                oicompare::stream_reader reader2{
+                    oicompare::view_source{test_case.second}};
+                ok = ok
+                     && compare_stream_result (
+                         test_case.first, test_case.second,
+                         test_case.expected_result,
+                         oicompare::compare (reader1, reader2), true);
+              }
+
+          // Files are compared as when they are not compressed.
+          oicompare::io::write_file (plain_path.c_str (), test_case.first);
+          fmt::memory_buffer buffer;
+          for (auto mode : {oicompare::io::comparison_mode::normal,
+                            oicompare::io::comparison_mode::ignore_whitespace})
+            {
+              oicompare::io::options options;
+              options.mode = mode;
+              auto compare = [&] (const std::filesystem::path &path) {
+                return oicompare::io::compare_files (
+                    path.c_str (), second_path.c_str (),
+                    oicompare::translations::english_translation<
+                        oicompare::translations::kind::terse>::format,
+                    buffer, options);
+              };
+              ok = ok && compare (first_path) == compare (plain_path);
+            }
+        }
+
+      // A truncated input is an error, thrown once the data before the
+      // truncation has been read.
+      auto compressed = compress ("1 2 3\n");
+      compressed.pop_back ();
+      oicompare::io::write_file (first_path.c_str (), compressed);
+      oicompare::io::write_file (second_path.c_str (), "1 2 3\n");
+      fmt::memory_buffer buffer;
+      try
+        {
+          oicompare::io::compare_files (
+              first_path.c_str (), second_path.c_str (),
+              oicompare::translations::english_translation<
+                  oicompare::translations::kind::terse>::format,
+              buffer);
+          ok = false;
+        }
+      catch (const std::runtime_error &)
+        {
+        }
+    }
+
+  std::filesystem::remove (first_path);
+  std::filesystem::remove (second_path);
+  std::filesystem::remove (plain_path);
+  return ok;
+}
+
+/**
+ * Runs a server and talks to it as a client would.
+ */
+bool
+test_service ()
+{
+  auto directory = std::filesystem::temp_directory_path ();
+  auto suffix = fmt::format ("oicompare-tester-{}", ::getpid ());
+  auto socket_path = directory / (suffix + ".sock");
+  auto first_path = directory / (suffix + "-1.txt");
+  auto second_path = directory / (suffix + "-2.txt");
+  std::ofstream{first_path} << "1 2\n3\n";
+  std::ofstream{second_path} << "1 2\n4\n";
+
+  oicompare::service::server server{socket_path.c_str (), 2};
+  std::thread thread{[&] { server.run (); }};
+
+  bool ok = true;
+  try
+    {
+      oicompare::service::client client{socket_path.c_str ()};
+
+      auto same = client.compare ("english_terse", first_path.native (),
+                                  first_path.native ());
+      ok = ok && same.status == 0 && same.message == "OK\n";
+
+      auto different = client.compare ("english_abbreviated",
+                                       first_path.native (),
+                                       second_path.native ());
+      ok = ok && different.status == 1
+           && different.message == "WRONG: line 2: expected \"3\", got "
+                                   "\"4\"\n";
+
+      int pipe1[2], pipe2[2];
+      if (::pipe (pipe1) != 0 || ::pipe (pipe2) != 0)
+        throw std::system_error{errno, std::generic_category (), "pipe"};
+      static_cast<void> (::write (pipe1[1], "a b", 3));
+      static_cast<void> (::write (pipe2[1], "a  b\n\n", 6));
+      ::close (pipe1[1]);
+      ::close (pipe2[1]);
+      auto piped = client.compare ("english_terse", pipe1[0], pipe2[0]);
+      ::close (pipe1[0]);
+      ::close (pipe2[0]);
+      ok = ok && piped.status == 0;
+
+      auto unknown = client.compare ("klingon_full", first_path.native (),
+                                     first_path.native ());
+      ok = ok && unknown.status == 2;
+
+      // The standard input of the server is not a path of a client.
+      auto standard_input
+          = client.compare ("english_terse", "-", first_path.native ());
+      auto empty = client.compare ("english_terse", first_path.native (), "");
+      ok = ok && standard_input.status == 2 && empty.status == 2;
+
+      // More open connections than threads are all served.
+      std::vector<oicompare::service::client> clients;
+      for (int i = 0; i < 3; ++i)
+        clients.emplace_back (socket_path.c_str ());
+      for (int round = 0; round < 2; ++round)
+        for (auto &other : clients)
+          ok = ok
+               && other.compare ("english_terse", first_path.native (),
+                                 first_path.native ())
+                          .status
+                      == 0;
+
+      auto statistics = client.statistics ();
+      ok = ok && statistics.status == 0
+           && statistics.message.starts_with ("requests 9\nbytes 105\n");
+
+      // Clients stalled in the middle of a request hold none of the threads.
+      std::vector<oicompare::service::detail::unique_fd> stalled;
+      for (int i = 0; i < 3; ++i)
+        {
+          auto &fd = stalled.emplace_back (::socket (AF_UNIX, SOCK_STREAM, 0));
+          auto address = oicompare::service::detail::make_address (
+              socket_path.c_str ());
+          if (::connect (fd.get (), reinterpret_cast<sockaddr *> (&address),
+                         sizeof (address))
+                  != 0
+              || ::write (fd.get (), "\1\0", 2) != 2)
+            throw std::system_error{errno, std::generic_category (),
+                                    "connect"};
+        }
+      ok = ok
+           && client.compare ("english_terse", first_path.native (),
+                              first_path.native ())
+                      .status
+                  == 0;
+    }
+  catch (const std::exception &e)
+    {
+      fmt::println ("{}", e.what ());
+      ok = false;
+    }
+
+  server.stop ();
+  thread.join ();
+  std::filesystem::remove (first_path);
+  std::filesystem::remove (second_path);
+
+  return ok;
+}
+
+/**
+ * Runs a program to its exit, with its standard input read from a file, and
+ * its standard output written to a file and returned.
+ *
+ * @return exit code and standard output
+ */
+std::pair<int, std::string>
+run_program (std::vector<const char *> args, const char *input_path,
+             const char *output_path)
+{
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init (&actions);
+  posix_spawn_file_actions_addopen (&actions, STDIN_FILENO, input_path,
+                                    O_RDONLY, 0);
+  posix_spawn_file_actions_addopen (&actions, STDOUT_FILENO, output_path,
+                                    O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  posix_spawn_file_actions_addopen (&actions, STDERR_FILENO, "/dev/null",
+                                    O_WRONLY, 0);
+
+  args.push_back (nullptr);
+  pid_t pid;
+  int error = ::posix_spawn (&pid, args[0], &actions, nullptr,
+                             const_cast<char *const *> (args.data ()),
+                             environ);
+  posix_spawn_file_actions_destroy (&actions);
+  if (error != 0)
+    throw std::system_error{error, std::generic_category (), args[0]};
+
+  int status;
+  while (::waitpid (pid, &status, 0) < 0)
+    if (errno != EINTR)
+      throw std::system_error{errno, std::generic_category (), "waitpid"};
+
+  std::ifstream output{output_path, std::ios::binary};
+  return {WIFEXITED (status) ? WEXITSTATUS (status) : -1,
+          {std::istreambuf_iterator<char>{output}, {}}};
+}
+
+/**
+ * Checks that oicompare-lean prints the same as oicompare and exits with the
+ * same code, both where it compares the files itself and where it executes
+ * oicompare instead.
+ */
+bool
+test_lean (const char *full, const char *lean)
+{
+  auto directory = std::filesystem::temp_directory_path ()
+                   / fmt::format ("oicompare-lean-{}", ::getpid ());
+  std::filesystem::create_directories (directory);
+  auto write = [&] (const char *name, std::string_view contents) {
+    auto path = directory / name;
+    oicompare::io::write_file (path.c_str (), contents);
+    return path.native ();
+  };
+  auto expected = write ("expected", "1 2\n3\n");
+  auto equal = write ("equal", "1  2\n3");
+  auto wrong = write ("wrong", "1 2\n3.25\n");
+  auto large = write ("large", std::string (70000, '1') + "\n");
+  auto compressed = write ("compressed", "\x1f\x8b not really gzip");
+  auto plain = "1 2\n3\n"sv;
+  auto compiled = write (
+      "compiled", oicompare::compile (plain.data (),
+                                      plain.data () + plain.size ()));
+  auto missing = (directory / "missing").native ();
+  auto output = (directory / "output").native ();
+
+  struct lean_case
+  {
+    std::vector<const char *> args;
+    const char *input;
+  };
+  const lean_case cases[] = {
+      // Taken by the lean path.
+      {{expected.c_str (), equal.c_str ()}, "/dev/null"},
+      {{expected.c_str (), wrong.c_str (), "english_full"}, "/dev/null"},
+      {{"-", wrong.c_str (), "english_abbreviated"}, expected.c_str ()},
+      {{expected.c_str (), missing.c_str ()}, "/dev/null"},
+      // Executing oicompare.
+      {{"--abs-epsilon=0.5", expected.c_str (), wrong.c_str ()}, "/dev/null"},
+      {{expected.c_str (), "-"}, "/dev/null"},
+      {{expected.c_str (), large.c_str (), "english_full"}, "/dev/null"},
+      {{expected.c_str (), compressed.c_str ()}, "/dev/null"},
+      {{compiled.c_str (), wrong.c_str (), "english_full"}, "/dev/null"},
+      {{expected.c_str (), equal.c_str (), "klingon_full"}, "/dev/null"},
+      {{expected.c_str ()}, "/dev/null"},
+  };
+
+  bool passed = true;
+  for (const auto &lean_case : cases)
+    {
+      auto args = lean_case.args;
+      args.insert (args.begin (), full);
+      auto full_result = run_program (args, lean_case.input, output.c_str ());
+      args[0] = lean;
+      auto lean_result = run_program (args, lean_case.input, output.c_str ());
+      if (lean_result != full_result)
+        {
+          std::string command{lean};
+          for (const auto *arg : lean_case.args)
+            command += fmt::format (" {}", arg);
+          fmt::println ("{}: got {} \"{}\", expected {} \"{}\"", command,
+                        lean_result.first, lean_result.second,
+                        full_result.first, full_result.second);
+          passed = false;
+        }
+    }
+
+  std::filesystem::remove_all (directory);
+  return passed;
+}
 }
 
+/*
+ * The paths to oicompare and oicompare-lean may be given as arguments, to
+ * check that they behave the same.
+ */
 int
-main ()
+main (int argc, char **argv)
 {
   std::size_t index = 0;
   for (const auto &test_case : test_cases)
@@ -94,6 +1365,253 @@ main ()
       ++index;
     }
 
+  index = 0;
+  for (const auto &test_case : test_cases)
+    {
+      for (std::size_t chunk_size : {1, 3, 64, 4096})
+        for (std::size_t buffer_size : {2, 7, 1024})
+          if (!test_stream (test_case, chunk_size, buffer_size))
+            {
+              fmt::println ("Stream test {} failed (chunk size {}, buffer "
+                            "size {})\n",
+                            index, chunk_size, buffer_size);
+              return 1;
+            }
+
+      ++index;
+    }
+
+  index = 0;
+  for (const auto &test_case : test_cases)
+    {
+      auto expected = test_case.expected_result;
+      expected.swap ();
+
+      if (!test_incremental (test_case.first, test_case.second,
+                             test_case.expected_result)
+          || !test_incremental (test_case.second, test_case.first, expected))
+        {
+          fmt::println ("Incremental test {} failed\n", index);
+          return 1;
+        }
+
+      ++index;
+    }
+
+  index = 0;
+  for (const auto &test_case : test_cases)
+    {
+      auto expected = test_case.expected_result;
+      expected.swap ();
+
+      if (!test_compiled (test_case.first, test_case.second,
+                          test_case.expected_result)
+          || !test_compiled (test_case.second, test_case.first, expected))
+        {
+          fmt::println ("Compiled test {} failed\n", index);
+          return 1;
+        }
+
+      ++index;
+    }
+
+  {
+    oicompare::thread_pool pool{4};
+    index = 0;
+    for (const auto &test_case : test_cases)
+      {
+        for (std::size_t block_size : {1, 2, 3, 7, 64})
+          {
+            auto result = oicompare::compare_parallel (
+                test_case.first, test_case.second, pool, block_size);
+            if (!compare_result (test_case.first.data (),
+                                 test_case.second.data (),
+                                 test_case.expected_result, result))
+              {
+                fmt::println ("Parallel test {} failed (block size {})\n",
+                              index, block_size);
+                return 1;
+              }
+          }
+
+        ++index;
+      }
+  }
+
+  // At run time, inputs are compared by the vector scanner.
+  if (!test_policy<oicompare::ignore_whitespace_policy> (
+          ignore_whitespace_test_cases)
+      || !test_policy<oicompare::ignore_blank_lines_policy> (
+          ignore_blank_lines_test_cases)
+      || !test_policy<oicompare::strict_whitespace_policy> (
+          strict_whitespace_test_cases)
+      || !test_policy<oicompare::case_insensitive_policy> (
+          case_insensitive_test_cases)
+      || !test_policy<oicompare::integer_policy> (integer_test_cases))
+    {
+      fmt::println ("Policy test failed\n");
+      return 1;
+    }
+
+  index = 0;
+  for (const auto &test_case : test_tolerance_cases)
+    {
+      if (!test_tolerance (test_case))
+        {
+          fmt::println ("Tolerance test {} failed\n", index);
+          return 1;
+        }
+
+      ++index;
+    }
+
+  {
+    auto first = "0.5"sv, second = "0.75"sv;
+    fmt::memory_buffer buffer;
+    oicompare::translations::english_translation<
+        oicompare::translations::kind::abbreviated>::
+        format (buffer, oicompare::compare (first.data (),
+                                            first.data () + first.size (),
+                                            second.data (),
+                                            second.data () + second.size (),
+                                            oicompare::tolerance{0.1, 0}));
+    if (fmt::to_string (buffer)
+        != "WRONG: line 1: expected \"0.5\", got \"0.75\", difference "
+           "0.25\n")
+      {
+        fmt::println ("Tolerance translation test failed");
+        return 1;
+      }
+  }
+
+  for (const auto &test_case : test_hash_cases)
+    if (!test_hash (test_case))
+      {
+        fmt::println ("Hash test failed: \"{}\"", test_case.data);
+        return 1;
+      }
+
+  if (!test_truncated_numbers ())
+    {
+      fmt::println ("Truncated numbers test failed");
+      return 1;
+    }
+
+  if (!test_counters ())
+    {
+      fmt::println ("Counters test failed");
+      return 1;
+    }
+
+  if (!test_offsets ())
+    {
+      fmt::println ("Offset test failed");
+      return 1;
+    }
+
+  if (!test_max_mismatches ())
+    {
+      fmt::println ("Maximum mismatches test failed");
+      return 1;
+    }
+
+  index = 0;
+  for (const auto &test_case : unordered_lines_test_cases)
+    {
+      if (!test_unordered (test_case, oicompare::unordered_unit::lines))
+        {
+          fmt::println ("Unordered lines test {} failed\n", index);
+          return 1;
+        }
+
+      ++index;
+    }
+
+  index = 0;
+  for (const auto &test_case : unordered_tokens_test_cases)
+    {
+      if (!test_unordered (test_case, oicompare::unordered_unit::tokens))
+        {
+          fmt::println ("Unordered tokens test {} failed\n", index);
+          return 1;
+        }
+
+      ++index;
+    }
+
+  // Equivalent inputs have the same lines and words.
+  index = 0;
+  for (const auto &test_case : test_cases)
+    {
+      if (std::holds_alternative<success> (test_case.expected_result)
+          && (!test_unordered (test_case, oicompare::unordered_unit::lines)
+              || !test_unordered (test_case,
+                                  oicompare::unordered_unit::tokens)))
+        {
+          fmt::println ("Unordered test {} failed\n", index);
+          return 1;
+        }
+
+      ++index;
+    }
+
+  if (!test_alternatives<oicompare::default_policy> (test_cases)
+      || !test_alternatives<oicompare::ignore_whitespace_policy> (
+          ignore_whitespace_test_cases)
+      || !test_alternatives<oicompare::ignore_blank_lines_policy> (
+          ignore_blank_lines_test_cases)
+      || !test_alternatives<oicompare::strict_whitespace_policy> (
+          strict_whitespace_test_cases)
+      || !test_alternatives<oicompare::case_insensitive_policy> (
+          case_insensitive_test_cases)
+      || !test_alternatives<oicompare::integer_policy> (integer_test_cases))
+    {
+      fmt::println ("Alternatives test failed\n");
+      return 1;
+    }
+
+  if (!test_alternative_files ())
+    {
+      fmt::println ("Alternative file test failed");
+      return 1;
+    }
+
+  if (!test_batch ())
+    {
+      fmt::println ("Batch test failed");
+      return 1;
+    }
+
+  if (!test_unordered_files ())
+    {
+      fmt::println ("Unordered file test failed");
+      return 1;
+    }
+
+  if (!test_read_strategies ())
+    {
+      fmt::println ("Read strategy test failed");
+      return 1;
+    }
+
+  if (!test_uring ())
+    {
+      fmt::println ("io_uring test failed");
+      return 1;
+    }
+
+  if (!test_window ())
+    {
+      fmt::println ("Window test failed");
+      return 1;
+    }
+
+  if (!test_compressed ())
+    {
+      fmt::println ("Compressed input test failed");
+      return 1;
+    }
+
   index = 0;
   for (const auto &test_case : test_translation_cases)
     {
@@ -141,5 +1659,17 @@ main ()
       ++index;
     }
 
+  if (!test_service ())
+    {
+      fmt::println ("Service test failed");
+      return 1;
+    }
+
+  if (argc == 3 && !test_lean (argv[1], argv[2]))
+    {
+      fmt::println ("Lean test failed");
+      return 1;
+    }
+
   return 0;
 }
\ No newline at end of file
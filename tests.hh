@@ -1,6 +1,7 @@
 #ifndef __OICOMPARE_TESTS_HH__
 #define __OICOMPARE_TESTS_HH__
 
+#include <cstdint>
 #include <variant>
 
 #include "oicompare.hh"
@@ -54,6 +55,29 @@ struct test_case
   std::string_view second;
 };
 
+struct test_tolerance_case
+{
+  oicompare::tolerance tolerance;
+  result expected_result;
+  std::string_view first;
+  std::string_view second;
+};
+
+struct test_alternatives_case
+{
+  std::size_t alternative;
+  result expected_result;
+  std::array<std::string_view, 3> expected;
+  std::string_view received;
+};
+
+struct test_hash_case
+{
+  std::string_view data;
+  std::uint64_t low;
+  std::uint64_t high;
+};
+
 struct test_translation_case
 {
   oicompare::translations::translation translator;
@@ -62,8 +86,23 @@ struct test_translation_case
   std::string_view result;
 };
 
+/**
+ * Reference MurmurHash3_x64_128 digests with the seed 0.
+ */
+constexpr auto test_hash_cases = std::array{
+    test_hash_case{""sv, 0x0000000000000000, 0x0000000000000000},
+    test_hash_case{"a"sv, 0x85555565f6597889, 0xe6b53a48510e895a},
+    test_hash_case{"abc"sv, 0xb4963f3f3fad7867, 0x3ba2744126ca2d52},
+    test_hash_case{"0123456789abcdef"sv, 0x4be06d94cf4ad1a7,
+                   0x87c35b5c63a708da},
+    test_hash_case{"0123456789abcdef0123456789abcdefX"sv, 0xa2ccbf4a105b6b65,
+                   0x5d8be6567d3a6108},
+    test_hash_case{"The quick brown fox jumps over the lazy dog"sv,
+                   0xe34bbc7bbc071b6c, 0x7a433ca9c49a9347}};
+
 #define REP10(X) X X X X X X X X X X
 #define REP100(X) REP10 (REP10 (X))
+#define REP10000(X) REP100 (REP100 (X))
 
 constexpr auto test_cases = std::array{
     // Identical
@@ -110,6 +149,212 @@ constexpr auto test_cases = std::array{
     test_case{
         {failure{1, {token_type::word, 0, 101}, {token_type::word, 0, 100}}},
         REP100 ("A"sv) "B"sv, REP100 ("A"sv) " B"sv},
+
+    // Tokens and whitespace spanning many blocks of the vector scanner
+    test_case{{success{}}, "A"sv REP100 (" "sv) "B"sv, "A\tB"sv},
+    test_case{{success{}}, REP100 ("12 "sv) "\n"sv, REP100 ("12\0"sv) "\n"sv},
+    test_case{
+        {failure{1, {token_type::word, 70, 71}, {token_type::word, 70, 71}}},
+        REP10 ("123456 "sv) "X\n"sv, REP10 ("123456\t"sv) "Y\n"sv},
+    test_case{{failure{101,
+                       {token_type::word, 100, 101},
+                       {token_type::word, 100, 101}}},
+              REP100 ("\n"sv) "A"sv, REP100 ("\n"sv) "B"sv},
+
+    // Mismatches after a long common prefix
+    test_case{{failure{101,
+                       {token_type::word, 200, 201},
+                       {token_type::word, 200, 201}}},
+              REP100 ("1\n"sv) "2\n"sv, REP100 ("1\n"sv) "3\n"sv},
+    test_case{
+        {failure{1, {token_type::word, 2, 103}, {token_type::word, 2, 103}}},
+        "x "sv REP100 ("7"sv) "1"sv, "x "sv REP100 ("7"sv) "2"sv},
+    test_case{
+        {failure{1, {token_type::word, 0, 100}, {token_type::word, 0, 101}}},
+        REP100 ("A"sv), REP100 ("A"sv) "B"sv},
+    test_case{{failure{2, {token_type::eof, 2, 2}, {token_type::word, 4, 5}}},
+              "A\n"sv, "A\n\n\nB"sv},
+    // Long trailing whitespace
+    test_case{{success{}}, "1 2\n"sv, "1 2"sv REP10000 (" "sv)},
+    test_case{{success{}}, "1 2"sv REP10000 ("\n"sv), "1 2\n"sv},
+    test_case{{success{}}, "5\n"sv, "5"sv REP10000 ("\0\r\n"sv)},
+    test_case{
+        {failure{2, {token_type::word, 2, 3}, {token_type::newline, 2, 3}}},
+        "1\n2"sv, "1"sv REP10000 ("\n"sv)},
+    test_case{{failure{1, {token_type::eof, 1, 1},
+                       {token_type::word, 10001, 10002}}},
+              "1"sv, "1"sv REP10000 (" "sv) "x"sv REP10000 (" "sv)},
+};
+
+constexpr auto ignore_whitespace_test_cases = std::array{
+    test_case{{success{}}, "A B\nC"sv, "A\nB C"sv},
+    test_case{{success{}}, "1 2 3"sv, "\n1\n\n2\n3\n"sv},
+    test_case{{failure{2, {token_type::word, 4, 5}, {token_type::word, 4, 5}}},
+              "A B\nC"sv, "A\nB D"sv},
+    test_case{{failure{2, {token_type::eof, 2, 2}, {token_type::word, 2, 3}}},
+              "A\n"sv, "A\nB"sv},
+    test_case{{failure{2,
+                       {token_type::word, 101, 102},
+                       {token_type::word, 101, 102}}},
+              REP100 (" "sv) "\nA"sv, "\n"sv REP100 (" "sv) "B"sv},
+};
+
+constexpr auto ignore_blank_lines_test_cases = std::array{
+    test_case{{success{}}, "A\n\nB\n"sv, "A\nB"sv},
+    test_case{{success{}}, "\n\nA"sv, "A\n\n\n"sv},
+    test_case{{success{}}, "A\n \t\nB"sv, "A\nB"sv},
+    test_case{
+        {failure{1, {token_type::newline, 1, 2}, {token_type::word, 2, 3}}},
+        "A\nB"sv, "A B"sv},
+    test_case{
+        {failure{1, {token_type::newline, 2, 3}, {token_type::word, 2, 3}}},
+        "A \nB"sv, "A B"sv},
+    test_case{{failure{4, {token_type::word, 5, 6}, {token_type::word, 5, 6}}},
+              "A\n\nB\nC"sv, "A\nB\n\nD"sv},
+};
+
+constexpr auto strict_whitespace_test_cases = std::array{
+    test_case{{success{}}, "A B\n"sv, "A B\n"sv},
+    test_case{{success{}}, "A  B\n"sv, "A\tB\n"sv},
+    test_case{
+        {failure{1, {token_type::word, 1, 2}, {token_type::newline, 1, 2}}},
+        "A \n"sv, "A\n"sv},
+    test_case{
+        {failure{2, {token_type::eof, 2, 2}, {token_type::newline, 2, 3}}},
+        "A\n"sv, "A\n\n"sv},
+    test_case{
+        {failure{1, {token_type::eof, 1, 1}, {token_type::newline, 1, 2}}},
+        "A"sv, "A\n"sv},
+    test_case{{failure{1, {token_type::word, 1, 3}, {token_type::word, 1, 3}}},
+              "A \t"sv, "A  "sv},
+    test_case{{failure{1, {token_type::word, 1, 3}, {token_type::word, 1, 2}}},
+              "A  \n"sv, "A \n"sv},
+};
+
+constexpr auto case_insensitive_test_cases = std::array{
+    test_case{{success{}}, "Yes\nNO"sv, "YES\nno"sv},
+    test_case{{success{}}, REP10 ("Ab"sv) " z"sv, REP10 ("aB"sv) " Z"sv},
+    test_case{{failure{1, {token_type::word, 0, 3}, {token_type::word, 0, 3}}},
+              "TAK"sv, "tac"sv},
+    test_case{{failure{1, {token_type::word, 0, 2}, {token_type::word, 0, 2}}},
+              "\xC4\x85"sv, "\xC4\x84"sv},
+};
+
+constexpr auto integer_test_cases = std::array{
+    test_case{{success{}}, "+5 05 -0\n007"sv, "5 5 0\n+7"sv},
+    test_case{{success{}}, REP100 ("0"sv) "1"sv REP100 ("9"sv),
+              "+1"sv REP100 ("9"sv)},
+    test_case{{failure{1, {token_type::word, 0, 2}, {token_type::word, 0, 1}}},
+              "-5"sv, "5"sv},
+    test_case{{failure{1, {token_type::word, 0, 2}, {token_type::word, 0, 4}}},
+              "12"sv, "012x"sv},
+    test_case{
+        {failure{1, {token_type::word, 0, 101}, {token_type::word, 0, 103}}},
+        "1"sv REP100 ("2"sv), "01"sv REP100 ("2"sv) "3"sv},
+    test_case{{failure{1, {token_type::word, 0, 1}, {token_type::word, 0, 1}}},
+              "- 1"sv, "+ 1"sv},
+};
+
+constexpr auto unordered_lines_test_cases = std::array{
+    test_case{{success{}}, "b 1\na  2\n\nc\n"sv, "c\na 2\nb\t1"sv},
+    test_case{{success{}}, ""sv, "\n\n"sv},
+    test_case{{failure{2, {token_type::word, 2, 3}, {token_type::word, 2, 3}}},
+              "a\nb\nb\n"sv, "b\na\na\n"sv},
+    test_case{{failure{1, {token_type::word, 0, 3}, {token_type::word, 0, 1}}},
+              "a b"sv, "a"sv},
+    test_case{{failure{1, {token_type::word, 0, 1}, {token_type::eof, 2, 2}}},
+              "x\ny"sv, "y\n"sv},
+    test_case{{failure{2, {token_type::eof, 1, 1}, {token_type::word, 2, 3}}},
+              "y"sv, "y\nx"sv},
+};
+
+constexpr auto unordered_tokens_test_cases = std::array{
+    test_case{{success{}}, "1 2 3\n4"sv, "4 3\n2 1\n"sv},
+    test_case{{failure{1, {token_type::word, 0, 1}, {token_type::word, 2, 3}}},
+              "1 1 2"sv, "1 2 2"sv},
+    test_case{{failure{1, {token_type::word, 0, 1}, {token_type::eof, 3, 3}}},
+              "1\n2 3"sv, "3 2"sv},
+};
+
+constexpr auto alternatives_test_cases = std::array{
+    test_alternatives_case{1,
+                           {success{}},
+                           {"1 2\n4"sv, "1  2\n3"sv, "1 2 3"sv},
+                           "1 2\n3\n"sv},
+    test_alternatives_case{0, {success{}}, {"a\n\n"sv, "a"sv, "b"sv}, "a"sv},
+    test_alternatives_case{1, {success{}}, {"1 2"sv, "1"sv, "1\n2"sv},
+                           "1\n\n\n"sv},
+    // The alternative matching the longest part is reported
+    test_alternatives_case{
+        1,
+        {failure{1, {token_type::word, 6, 7}, {token_type::word, 6, 7}}},
+        {"1 5"sv, "1 2 3 5"sv, "1 2 6"sv},
+        "1 2 3 4"sv},
+    test_alternatives_case{
+        2,
+        {failure{1, {token_type::word, 2, 3}, {token_type::eof, 1, 1}}},
+        {"y"sv, "z"sv, "x y"sv},
+        "x"sv},
+    test_alternatives_case{
+        0,
+        {failure{2, {token_type::word, 2, 3}, {token_type::word, 2, 3}}},
+        {"x\nz"sv, "x\nw"sv, "q"sv},
+        "x\ny"sv},
+    test_alternatives_case{
+        0,
+        {failure{3, {token_type::word, 4, 5}, {token_type::word, 4, 5}}},
+        {"a\nb\nd"sv, "a\nx"sv, "a\nb\ne\nf"sv},
+        "a\nb\nc"sv},
+    test_alternatives_case{
+        0,
+        {failure{1, {token_type::eof, 1, 1}, {token_type::word, 3, 4}}},
+        {"1"sv, "1\n\n2x"sv, "0"sv},
+        "1\n\n2"sv},
+};
+
+constexpr auto test_tolerance_cases = std::array{
+    // Close enough
+    test_tolerance_case{{1e-6, 0}, {success{}}, "1.0 2.5\n"sv,
+                        "1.0000001 2.5\n"sv},
+    test_tolerance_case{{0, 1e-3}, {success{}}, "1000"sv, "1000.5"sv},
+    test_tolerance_case{{1e-9, 0}, {success{}}, "1"sv,
+                        "1.000000000000000000000000000001"sv},
+    test_tolerance_case{{0, 0}, {success{}}, "+1 -0 1e5"sv, "1 0 100000"sv},
+    test_tolerance_case{{1e-12, 0}, {success{}},
+                        "3.14159265358979323846264338327950288"sv,
+                        "3.141592653589793"sv},
+
+    // Too far
+    test_tolerance_case{
+        {1e-6, 0},
+        {failure{1, {token_type::word, 0, 3}, {token_type::word, 0, 6}}},
+        "0.5"sv, "0.5001"sv},
+    test_tolerance_case{
+        {0, 1e-3},
+        {failure{1, {token_type::word, 0, 4}, {token_type::word, 0, 4}}},
+        "1000"sv, "1002"sv},
+
+    // Not numbers
+    test_tolerance_case{
+        {1, 1},
+        {failure{1, {token_type::word, 0, 3}, {token_type::word, 0, 3}}},
+        "abc"sv, "abd"sv},
+    test_tolerance_case{
+        {1, 1},
+        {failure{1, {token_type::word, 0, 3}, {token_type::word, 0, 4}}},
+        "1.5"sv, "1.5."sv},
+    test_tolerance_case{
+        {1, 1},
+        {failure{1, {token_type::word, 0, 1}, {token_type::word, 0, 3}}},
+        "1"sv, "inf"sv},
+    test_tolerance_case{
+        {1, 1},
+        {failure{1, {token_type::word, 0, 4}, {token_type::word, 0, 2}}},
+        "0x10"sv, "16"sv},
+    test_tolerance_case{
+        {1, 1},
+        {failure{2, {token_type::eof, 4, 4}, {token_type::word, 4, 5}}},
+        "1 2\n"sv, "1 2\n3"sv},
 };
 
 constexpr auto test_translation_cases = std::array{
@@ -149,7 +394,36 @@ constexpr auto test_translation_cases = std::array{
     test_translation_case{
         translations::english_translation<translations::kind::full>::print,
         "0\n0\n"sv, "0\n"sv,
-        "WRONG: line 2: expected \"0\", got end of file\n"sv}};
+        "WRONG: line 2: expected \"0\", got end of file\n"sv},
+    test_translation_case{translations::json_translation::print, "ABC"sv,
+                          "ABC"sv, "{\"verdict\":\"OK\"}\n"sv},
+    test_translation_case{
+        translations::json_translation::print, "ABC\nDEF\n"sv,
+        "ABC\nDEG\n"sv,
+        "{\"verdict\":\"WRONG\",\"line\":2,\"first_difference\":2,"
+        "\"expected\":{\"type\":\"word\",\"offset\":null,\"text\":\"DEF\","
+        "\"truncated\":false},\"received\":{\"type\":\"word\",\"offset\":null,"
+        "\"text\":\"DEG\",\"truncated\":false}}\n"sv},
+    test_translation_case{
+        translations::json_translation::print, "a\"\\\x01"sv, "b"sv,
+        "{\"verdict\":\"WRONG\",\"line\":1,\"first_difference\":0,"
+        "\"expected\":{\"type\":\"word\",\"offset\":null,"
+        "\"text\":\"a\\\"\\\\\\u0001\",\"truncated\":false},"
+        "\"received\":{\"type\":\"word\",\"offset\":null,\"text\":\"b\","
+        "\"truncated\":false}}\n"sv},
+    test_translation_case{
+        translations::json_translation::print, "1"sv REP100 ("0"sv), "1 2"sv,
+        "{\"verdict\":\"WRONG\",\"line\":1,\"first_difference\":1,"
+        "\"expected\":{\"type\":\"word\",\"offset\":null,\"text\":\"1"
+        "000000000000000000000000000000000000000000000000000000000000000\","
+        "\"truncated\":true},\"received\":{\"type\":\"word\",\"offset\":null,"
+        "\"text\":\"1\",\"truncated\":false}}\n"sv},
+    test_translation_case{
+        translations::json_translation::print, "0"sv, "0 1"sv,
+        "{\"verdict\":\"WRONG\",\"line\":1,\"first_difference\":null,"
+        "\"expected\":{\"type\":\"eof\",\"offset\":null,\"text\":\"\","
+        "\"truncated\":false},\"received\":{\"type\":\"word\",\"offset\":null,"
+        "\"text\":\"1\",\"truncated\":false}}\n"sv}};
 
 #undef REP100
 #undef REP10
@@ -183,6 +457,45 @@ compare_result (It1 first1, It2 first2, const result &expected,
   else
     return !got;
 }
+
+constexpr bool
+compare_stream_token (std::string_view input, const token &expected,
+                      const oicompare::token<const char *> &got)
+{
+  return expected.type == got.type
+         && std::string_view{got.first, got.last}
+                == input.substr (expected.first,
+                                 expected.last - expected.first);
+}
+
+/**
+ * Compares the result of comparing streams, whose tokens point into the
+ * buffers of the readers.
+ *
+ * If exact is not set, only the verdict and the line number are compared.
+ */
+constexpr bool
+compare_stream_result (
+    std::string_view first, std::string_view second, const result &expected,
+    const std::optional<oicompare::mismatch<const char *, const char *>> &got,
+    bool exact)
+{
+  if (std::holds_alternative<failure> (expected))
+    {
+      if (!got)
+        return false;
+
+      const auto &fail = std::get<failure> (expected);
+
+      return fail.line_number == got->line_number
+             && (!exact
+                 || (compare_stream_token (first, fail.first, got->first)
+                     && compare_stream_token (second, fail.second,
+                                              got->second)));
+    }
+  else
+    return !got;
+}
 }
 
 #endif /* __OICOMPARE_TESTS_HH__ */
\ No newline at end of file
@@ -0,0 +1,225 @@
+#ifndef __OICOMPARE_THREAD_POOL_HH__
+#define __OICOMPARE_THREAD_POOL_HH__
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace oicompare
+{
+/**
+ * A fixed number of threads running submitted tasks.
+ *
+ * Every thread has its own queue, tasks are distributed between the queues in
+ * a round-robin fashion. A thread takes tasks from the front of its queue, in
+ * the order of submission, and once it is empty, steals tasks from the back of
+ * the other queues.
+ */
+class thread_pool
+{
+public:
+  /**
+   * @param size number of threads, at least one is started
+   */
+  explicit thread_pool (
+      std::size_t size = std::thread::hardware_concurrency ())
+      : queues_ (std::max (size, std::size_t{1}))
+  {
+    threads_.reserve (queues_.size ());
+    for (std::size_t i = 0; i < queues_.size (); ++i)
+      threads_.emplace_back ([this, i] { work (i); });
+  }
+
+  thread_pool (const thread_pool &) = delete;
+  thread_pool &operator= (const thread_pool &) = delete;
+
+  /**
+   * Waits for all the submitted tasks and stops the threads.
+   */
+  ~thread_pool ()
+  {
+    {
+      std::lock_guard lock{mutex_};
+      stopping_ = true;
+    }
+    available_.notify_all ();
+
+    for (auto &thread : threads_)
+      thread.join ();
+  }
+
+  /**
+   * Number of threads.
+   */
+  std::size_t
+  size () const noexcept
+  {
+    return threads_.size ();
+  }
+
+  /**
+   * Submits a task. Exceptions thrown by the task terminate the program.
+   */
+  void
+  submit (std::function<void ()> task)
+  {
+    auto &queue = queues_[next_queue_++ % queues_.size ()];
+    {
+      // The task is counted before a thread can take it and count it off.
+      std::lock_guard lock{mutex_};
+      ++queued_;
+      ++pending_;
+
+      std::lock_guard queue_lock{queue.mutex};
+      queue.tasks.push_back (std::move (task));
+    }
+    available_.notify_one ();
+  }
+
+  /**
+   * Waits until all the submitted tasks are finished.
+   */
+  void
+  wait ()
+  {
+    std::unique_lock lock{mutex_};
+    finished_.wait (lock, [this] { return pending_ == 0; });
+  }
+
+private:
+  struct queue
+  {
+    std::mutex mutex;
+    std::deque<std::function<void ()>> tasks;
+  };
+
+  std::optional<std::function<void ()>>
+  take (std::size_t index)
+  {
+    std::optional<std::function<void ()>> task;
+
+    for (std::size_t i = 0; i < queues_.size () && !task; ++i)
+      {
+        auto &queue = queues_[(index + i) % queues_.size ()];
+        std::lock_guard lock{queue.mutex};
+        if (queue.tasks.empty ())
+          continue;
+        else if (i == 0)
+          {
+            task = std::move (queue.tasks.front ());
+            queue.tasks.pop_front ();
+          }
+        else
+          {
+            task = std::move (queue.tasks.back ());
+            queue.tasks.pop_back ();
+          }
+      }
+
+    if (task)
+      {
+        std::lock_guard lock{mutex_};
+        --queued_;
+      }
+
+    return task;
+  }
+
+  void
+  work (std::size_t index)
+  {
+    while (true)
+      {
+        if (auto task = take (index))
+          {
+            (*task) ();
+
+            std::lock_guard lock{mutex_};
+            if (--pending_ == 0)
+              finished_.notify_all ();
+            continue;
+          }
+
+        std::unique_lock lock{mutex_};
+        available_.wait (lock, [this] { return stopping_ || queued_ > 0; });
+        if (stopping_ && queued_ == 0)
+          return;
+      }
+  }
+
+  std::vector<queue> queues_;
+  std::vector<std::thread> threads_;
+  std::atomic<std::size_t> next_queue_ = 0;
+
+  std::mutex mutex_;
+  std::condition_variable available_;
+  std::condition_variable finished_;
+  std::size_t queued_ = 0;
+  std::size_t pending_ = 0;
+  bool stopping_ = false;
+};
+
+/**
+ * A group of tasks submitted to a thread pool, which can be waited for
+ * without waiting for the other tasks of the pool.
+ *
+ * It must not be waited for by a task of the same pool, which could leave no
+ * thread to run the tasks of the group.
+ */
+class task_group
+{
+public:
+  explicit task_group (thread_pool &pool) noexcept : pool_{pool} {}
+
+  task_group (const task_group &) = delete;
+  task_group &operator= (const task_group &) = delete;
+
+  ~task_group () { wait (); }
+
+  /**
+   * Submits a task. Exceptions thrown by the task terminate the program.
+   */
+  void
+  submit (std::function<void ()> task)
+  {
+    {
+      std::lock_guard lock{mutex_};
+      ++pending_;
+    }
+
+    pool_.submit ([this, task = std::move (task)] {
+      task ();
+
+      std::lock_guard lock{mutex_};
+      if (--pending_ == 0)
+        finished_.notify_all ();
+    });
+  }
+
+  /**
+   * Waits until all the tasks of the group are finished.
+   */
+  void
+  wait ()
+  {
+    std::unique_lock lock{mutex_};
+    finished_.wait (lock, [this] { return pending_ == 0; });
+  }
+
+private:
+  thread_pool &pool_;
+  std::mutex mutex_;
+  std::condition_variable finished_;
+  std::size_t pending_ = 0;
+};
+}
+
+#endif /* __OICOMPARE_THREAD_POOL_HH__ */
\ No newline at end of file
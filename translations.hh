@@ -4,15 +4,20 @@
 #include <algorithm>
 #include <array>
 #include <cassert>
+#include <cmath>
 #include <cstddef>
+#include <cstdio>
 #include <iterator>
+#include <optional>
 #include <string_view>
 #include <utility>
 
 #include <fmt/format.h>
+#include <unistd.h>
 
 #include "oicompare.hh"
 #include "print_format.hh"
+#include "write.hh"
 
 namespace oicompare::translations
 {
@@ -280,31 +285,53 @@ template <kind Kind> struct english_translation
   }
 
   static void
-  print (const std::optional<oicompare::mismatch<const char *, const char *>>
-             &mismatch)
+  format (fmt::memory_buffer &buffer,
+          const std::optional<oicompare::mismatch<const char *, const char *>>
+              &mismatch)
   {
+    auto out = std::back_inserter (buffer);
     if (mismatch)
       switch (Kind)
         {
         case kind::terse:
-          fmt::println ("WRONG");
+          fmt::format_to (out, "WRONG\n");
           break;
         case kind::abbreviated:
         case kind::full:
-          fmt::println ("WRONG: line {}: expected {}, got {}",
-                        mismatch->line_number,
-                        represent (mismatch->first,
-                                   mismatch->first_difference.has_value ()
-                                       ? mismatch->first_difference->first
-                                       : nullptr),
-                        represent (mismatch->second,
-                                   mismatch->first_difference.has_value ()
-                                       ? mismatch->first_difference->second
-                                       : nullptr));
+          fmt::format_to (out, "WRONG: line {}: expected {}, got {}",
+                          mismatch->line_number,
+                          represent (mismatch->first,
+                                     mismatch->first_difference.has_value ()
+                                         ? mismatch->first_difference->first
+                                         : nullptr),
+                          represent (mismatch->second,
+                                     mismatch->first_difference.has_value ()
+                                         ? mismatch->first_difference->second
+                                         : nullptr));
+          if (mismatch->numeric_difference)
+            fmt::format_to (out, ", difference {:g}",
+                            *mismatch->numeric_difference);
+          fmt::format_to (out, "\n");
           break;
         }
     else
-      fmt::println ("OK");
+      fmt::format_to (out, "OK\n");
+  }
+
+  static void
+  format_count (fmt::memory_buffer &buffer, std::size_t lines)
+  {
+    fmt::format_to (std::back_inserter (buffer), "Mismatched lines: {}\n",
+                    lines);
+  }
+
+  static void
+  print (const std::optional<oicompare::mismatch<const char *, const char *>>
+             &mismatch)
+  {
+    fmt::memory_buffer buffer;
+    format (buffer, mismatch);
+    std::fwrite (buffer.data (), 1, buffer.size (), stdout);
   }
 };
 
@@ -346,36 +373,250 @@ template <kind Kind> struct polish_translation
   }
 
   static void
-  print (const std::optional<oicompare::mismatch<const char *, const char *>>
-             &mismatch)
+  format (fmt::memory_buffer &buffer,
+          const std::optional<oicompare::mismatch<const char *, const char *>>
+              &mismatch)
   {
+    auto out = std::back_inserter (buffer);
     if (mismatch)
       switch (Kind)
         {
         case kind::terse:
-          fmt::println ("ŹLE");
+          fmt::format_to (out, "ŹLE\n");
           break;
         case kind::abbreviated:
         case kind::full:
-          fmt::println ("ŹLE: wiersz {}: oczekiwano {}, otrzymano {}",
-                        mismatch->line_number,
-                        represent (mismatch->first,
-                                   mismatch->first_difference.has_value ()
-                                       ? mismatch->first_difference->first
-                                       : nullptr),
-                        represent (mismatch->second,
-                                   mismatch->first_difference.has_value ()
-                                       ? mismatch->first_difference->second
-                                       : nullptr));
+          fmt::format_to (
+              out, "ŹLE: wiersz {}: oczekiwano {}, otrzymano {}",
+              mismatch->line_number,
+              represent (mismatch->first,
+                         mismatch->first_difference.has_value ()
+                             ? mismatch->first_difference->first
+                             : nullptr),
+              represent (mismatch->second,
+                         mismatch->first_difference.has_value ()
+                             ? mismatch->first_difference->second
+                             : nullptr));
+          if (mismatch->numeric_difference)
+            fmt::format_to (out, ", różnica {:g}",
+                            *mismatch->numeric_difference);
+          fmt::format_to (out, "\n");
           break;
         }
     else
-      fmt::println ("OK");
+      fmt::format_to (out, "OK\n");
+  }
+
+  static void
+  format_count (fmt::memory_buffer &buffer, std::size_t lines)
+  {
+    fmt::format_to (std::back_inserter (buffer), "Błędne wiersze: {}\n",
+                    lines);
+  }
+
+  static void
+  print (const std::optional<oicompare::mismatch<const char *, const char *>>
+             &mismatch)
+  {
+    fmt::memory_buffer buffer;
+    format (buffer, mismatch);
+    std::fwrite (buffer.data (), 1, buffer.size (), stdout);
+  }
+};
+
+/**
+ * Reports the result as one line of JSON, for programs rather than people:
+ *
+ *   {"verdict":"OK"}
+ *   {"verdict":"WRONG","line":1,"first_difference":2,
+ *    "expected":{"type":"word","offset":4,"text":"abc","truncated":false},
+ *    "received":{"type":"word","offset":4,"text":"abd","truncated":false}}
+ *
+ * The type of a token is word, newline or eof, its offset is null if it is
+ * not known, and first_difference is the index of the first differing
+ * character of two words, or null. Numbers compared with a tolerance also
+ * have the difference. The text of a word is cut to at most text_max bytes,
+ * with the bytes outside printable ASCII escaped as \u00XX, so that it maps
+ * back to bytes one to one.
+ *
+ * The line always fits in the inline storage of fmt::memory_buffer, so
+ * formatting it does not allocate, and print() writes it with a single
+ * write().
+ */
+struct json_translation
+{
+  /**
+   * Maximum number of bytes of the text of a token.
+   */
+  static constexpr std::size_t text_max = 64;
+
+  // The rest of the line takes at most about 300 bytes.
+  static_assert (2 * text_max + 320 <= fmt::inline_buffer_size);
+
+  template <std::output_iterator<char> OutputIt>
+  static OutputIt
+  represent (OutputIt out, const oicompare::token<const char *> &token,
+             std::optional<std::size_t> offset)
+  {
+    using namespace std::string_view_literals;
+
+    auto type = token.type == oicompare::token_type::word      ? "word"sv
+                : token.type == oicompare::token_type::newline ? "newline"sv
+                                                               : "eof"sv;
+    out = fmt::format_to (out, "{{\"type\":\"{}\",\"offset\":", type);
+    if (offset)
+      out = fmt::format_to (out, "{}", *offset);
+    else
+      out = std::move (std::ranges::copy ("null"sv, std::move (out)).out);
+    out = std::move (
+        std::ranges::copy (",\"text\":\""sv, std::move (out)).out);
+
+    std::string_view text;
+    if (token.type == oicompare::token_type::word)
+      text = {token.first, token.last};
+
+    std::size_t used = 0;
+    bool truncated = false;
+    for (char ch : text)
+      {
+        bool plain = ch >= 32 && ch <= 126;
+        std::size_t length = !plain ? 6 : ch == '"' || ch == '\\' ? 2 : 1;
+        if (used + length > text_max)
+          {
+            truncated = true;
+            break;
+          }
+        used += length;
+
+        if (!plain)
+          out = fmt::format_to (out, "\\u{:04X}",
+                                static_cast<unsigned char> (ch));
+        else
+          {
+            if (length == 2)
+              *out++ = '\\';
+            *out++ = ch;
+          }
+      }
+
+    return fmt::format_to (out, "\",\"truncated\":{}}}", truncated);
+  }
+
+  static void
+  format (fmt::memory_buffer &buffer,
+          const std::optional<oicompare::mismatch<const char *, const char *>>
+              &mismatch)
+  {
+    using namespace std::string_view_literals;
+
+    auto out = std::back_inserter (buffer);
+    if (!mismatch)
+      {
+        fmt::format_to (out, "{{\"verdict\":\"OK\"}}\n");
+        return;
+      }
+
+    out = fmt::format_to (
+        out, "{{\"verdict\":\"WRONG\",\"line\":{},\"first_difference\":",
+        mismatch->line_number);
+    if (mismatch->first_difference)
+      out = fmt::format_to (out, "{}",
+                            mismatch->first_difference->first
+                                - mismatch->first.first);
+    else
+      out = std::move (std::ranges::copy ("null"sv, std::move (out)).out);
+
+    out = std::move (
+        std::ranges::copy (",\"expected\":"sv, std::move (out)).out);
+    out = represent (out, mismatch->first, mismatch->offsets.first);
+    out = std::move (
+        std::ranges::copy (",\"received\":"sv, std::move (out)).out);
+    out = represent (out, mismatch->second, mismatch->offsets.second);
+
+    // JSON has no infinities.
+    if (mismatch->numeric_difference
+        && std::isfinite (*mismatch->numeric_difference))
+      out = fmt::format_to (out, ",\"difference\":{:g}",
+                            *mismatch->numeric_difference);
+    fmt::format_to (out, "}}\n");
+  }
+
+  static void
+  format_count (fmt::memory_buffer &buffer, std::size_t lines)
+  {
+    fmt::format_to (std::back_inserter (buffer),
+                    "{{\"mismatched_lines\":{}}}\n", lines);
+  }
+
+  static void
+  print (const std::optional<oicompare::mismatch<const char *, const char *>>
+             &mismatch)
+  {
+    fmt::memory_buffer buffer;
+    format (buffer, mismatch);
+    // Writes of at most PIPE_BUF bytes are not split, even into a pipe.
+    io::write_all (STDOUT_FILENO, {buffer.data (), buffer.size ()});
   }
 };
 
 using translation = void (*) (
     const std::optional<oicompare::mismatch<const char *, const char *>> &);
+
+using formatter = void (*) (
+    fmt::memory_buffer &,
+    const std::optional<oicompare::mismatch<const char *, const char *>> &);
+
+/**
+ * Finds a translation by its name, in the form language_kind, or json.
+ *
+ * @param name name of the translation
+ * @return formatter or nullptr if there is no such translation
+ */
+inline formatter
+parse (std::string_view name)
+{
+  using namespace std::string_view_literals;
+
+  if (name == "english_abbreviated"sv)
+    return english_translation<kind::abbreviated>::format;
+  else if (name == "english_full"sv)
+    return english_translation<kind::full>::format;
+  else if (name == "english_terse"sv)
+    return english_translation<kind::terse>::format;
+  else if (name == "json"sv)
+    return json_translation::format;
+  else if (name == "polish_abbreviated"sv)
+    return polish_translation<kind::abbreviated>::format;
+  else if (name == "polish_full"sv)
+    return polish_translation<kind::full>::format;
+  else if (name == "polish_terse"sv)
+    return polish_translation<kind::terse>::format;
+  else
+    return nullptr;
+}
+
+using count_formatter = void (*) (fmt::memory_buffer &, std::size_t);
+
+/**
+ * Finds the formatter of the number of mismatched lines of a translation.
+ *
+ * @param name name of the translation
+ * @return formatter or nullptr if there is no such translation
+ */
+inline count_formatter
+parse_count (std::string_view name)
+{
+  using namespace std::string_view_literals;
+
+  if (!parse (name))
+    return nullptr;
+  else if (name == "json"sv)
+    return json_translation::format_count;
+  else if (name.starts_with ("polish_"sv))
+    return polish_translation<kind::full>::format_count;
+  else
+    return english_translation<kind::full>::format_count;
+}
 }
 
 #endif /* __OICOMPARE_TRANSLATIONS_HH__ */
\ No newline at end of file
@@ -0,0 +1,528 @@
+#ifndef __OICOMPARE_UNORDERED_HH__
+#define __OICOMPARE_UNORDERED_HH__
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <optional>
+#include <ranges>
+#include <system_error>
+#include <vector>
+
+#include "hash.hh"
+#include "oicompare.hh"
+
+namespace oicompare
+{
+/**
+ * The parts of the inputs compared by compare_unordered().
+ */
+enum class unordered_unit
+{
+  /**
+   * Lines with words, compared as their words separated by single spaces.
+   */
+  lines,
+
+  /**
+   * Words, wherever the lines end.
+   */
+  tokens,
+};
+
+/**
+ * Default number of bytes of the table of compare_unordered(), beyond which
+ * the inputs are partitioned into temporary files.
+ */
+constexpr std::size_t default_unordered_memory_limit = std::size_t{1} << 30;
+
+namespace detail
+{
+/**
+ * Where a line or word is in an input.
+ */
+struct unordered_occurrence
+{
+  const char *first = nullptr;
+  const char *last = nullptr;
+  std::size_t line = 0;
+};
+
+/**
+ * A line or word of an input, with the hash of its canonical form.
+ */
+struct unordered_item
+{
+  hash128 hash;
+  unordered_occurrence occurrence;
+};
+
+/**
+ * Calls a function with every line with words, or every word, of a
+ * contiguous input, until it returns false. The words are those of compare()
+ * with the default policy.
+ *
+ * @return whether the function returned true for every item
+ */
+template <typename Func>
+bool
+for_each_item (const char *first, const char *last, unordered_unit unit,
+               Func &&func)
+{
+  block_scanner scanner{first, last};
+  std::size_t line = 1;
+  if (unit == unordered_unit::tokens)
+    {
+      for (auto tok = scanner.next (); tok.type != token_type::eof;
+           tok = scanner.next ())
+        if (tok.type == token_type::newline)
+          ++line;
+        else
+          {
+            hasher word;
+            word.update (tok.first, tok.last - tok.first);
+            if (!func (unordered_item{word.finish (),
+                                      {tok.first, tok.last, line}}))
+              return false;
+          }
+      return true;
+    }
+
+  // The words of a line separated by single spaces are hashed in bulk.
+  hasher line_hasher;
+  const char *begin = nullptr, *run = nullptr, *end = nullptr;
+  for (auto tok = scanner.next ();; tok = scanner.next ())
+    {
+      if (tok.type == token_type::word)
+        {
+          if (!begin)
+            begin = run = tok.first;
+          else if (tok.first - end != 1 || *end != ' ')
+            {
+              line_hasher.update (run, end - run);
+              line_hasher.update (" ", 1);
+              run = tok.first;
+            }
+          end = tok.last;
+          continue;
+        }
+
+      if (begin)
+        {
+          line_hasher.update (run, end - run);
+          if (!func (unordered_item{line_hasher.finish (),
+                                    {begin, end, line}}))
+            return false;
+          line_hasher = {};
+          begin = nullptr;
+        }
+      if (tok.type == token_type::eof)
+        return true;
+      ++line;
+    }
+}
+
+/**
+ * The earliest items of each input which the other one has fewer of.
+ */
+struct unordered_differences
+{
+  std::optional<unordered_occurrence> missing;
+  std::optional<unordered_occurrence> extra;
+
+  static void
+  add (std::optional<unordered_occurrence> &found,
+       const unordered_occurrence &item) noexcept
+  {
+    if (!found || item.line < found->line
+        || (item.line == found->line && item.first < found->first))
+      found = item;
+  }
+
+  /**
+   * The mismatch of the earliest missing item with the earliest extra one,
+   * or an end of file in place of either of them.
+   */
+  std::optional<mismatch<const char *, const char *>>
+  result (const char *last1, const char *last2) const
+  {
+    if (!missing && !extra)
+      return std::nullopt;
+
+    token<const char *> first{token_type::eof, last1, last1};
+    token<const char *> second{token_type::eof, last2, last2};
+    if (missing)
+      first = {token_type::word, missing->first, missing->last};
+    if (extra)
+      second = {token_type::word, extra->first, extra->last};
+    auto difference = first.compare (second);
+    return {{missing ? missing->line : extra->line,
+             difference ? std::move (*difference) : std::nullopt, first,
+             second}};
+  }
+};
+
+/**
+ * A multiset of items of two inputs, counting the occurrences in the first
+ * one minus those in the second one by their hashes, in an open addressing
+ * table with linear probing. The slots are allocated at once, and again every
+ * time the table doubles, when the old and the new slots together must fit in
+ * the memory limit.
+ */
+class unordered_table
+{
+public:
+  explicit unordered_table (std::size_t memory_limit)
+      : memory_limit_{memory_limit}, slots_ (min_slots)
+  {
+  }
+
+  /**
+   * Adds an occurrence of an item.
+   *
+   * @param hash hash of the item
+   * @param input 0 for the first input, 1 for the second one
+   * @return false if the table would not fit in the memory limit
+   */
+  bool
+  add (const hash128 &hash, int input)
+  {
+    if ((size_ + 1) * 2 > slots_.size ())
+      {
+        if (slots_.size () * 3 > memory_limit_ / sizeof (slot))
+          return false;
+        grow ();
+      }
+
+    auto &slot = slots_[find (key (hash))];
+    if (slot.hash == hash128{})
+      {
+        slot.hash = key (hash);
+        ++size_;
+      }
+    unbalanced_ -= slot.count != 0;
+    slot.count += input == 0 ? 1 : -1;
+    unbalanced_ += slot.count != 0;
+    return true;
+  }
+
+  /**
+   * The occurrences of an item in the first input minus those in the second
+   * one.
+   */
+  std::ptrdiff_t
+  count (const hash128 &hash) const noexcept
+  {
+    return slots_[find (key (hash))].count;
+  }
+
+  /**
+   * Number of distinct items.
+   */
+  std::size_t
+  size () const noexcept
+  {
+    return size_;
+  }
+
+  /**
+   * Whether any item occurs a different number of times in the inputs.
+   */
+  bool
+  unbalanced () const noexcept
+  {
+    return unbalanced_ > 0;
+  }
+
+  /**
+   * Number of bytes of a slot.
+   */
+  static constexpr std::size_t
+  slot_size () noexcept
+  {
+    return sizeof (slot);
+  }
+
+private:
+  static constexpr std::size_t min_slots = 1024;
+
+  struct slot
+  {
+    hash128 hash{};
+    std::ptrdiff_t count = 0;
+  };
+
+  /**
+   * The hash of an item in the table, where zero marks empty slots.
+   */
+  static hash128
+  key (hash128 hash) noexcept
+  {
+    if (hash == hash128{})
+      hash.low = 1;
+    return hash;
+  }
+
+  /**
+   * The index of the slot of a key, or of the empty slot where it belongs.
+   */
+  std::size_t
+  find (const hash128 &hash) const noexcept
+  {
+    auto mask = slots_.size () - 1;
+    for (auto index = hash.low & mask;; index = (index + 1) & mask)
+      if (slots_[index].hash == hash || slots_[index].hash == hash128{})
+        return index;
+  }
+
+  void
+  grow ()
+  {
+    std::vector<slot> old (slots_.size () * 2);
+    old.swap (slots_);
+    for (const auto &slot : old)
+      if (slot.hash != hash128{})
+        slots_[find (slot.hash)] = slot;
+  }
+
+  std::size_t memory_limit_;
+  std::vector<slot> slots_;
+  std::size_t size_ = 0;
+  // Number of items whose count is not zero.
+  std::size_t unbalanced_ = 0;
+};
+
+/**
+ * An item of an input in a partition.
+ */
+struct unordered_record
+{
+  hash128 hash;
+  std::uint64_t offset;
+  std::uint64_t size;
+  std::uint64_t line;
+  std::uint64_t input;
+};
+
+using partition_file = std::unique_ptr<std::FILE, decltype (&std::fclose)>;
+
+inline std::vector<partition_file>
+make_partitions (std::size_t partitions)
+{
+  std::vector<partition_file> files;
+  for (std::size_t i = 0; i < partitions; ++i)
+    {
+      files.emplace_back (std::tmpfile (), std::fclose);
+      if (!files.back ())
+        throw std::system_error{errno, std::generic_category (), "tmpfile"};
+    }
+  return files;
+}
+
+inline void
+write_record (std::FILE *file, const unordered_record &rec)
+{
+  if (std::fwrite (&rec, sizeof (rec), 1, file) != 1)
+    throw std::system_error{errno, std::generic_category (), "fwrite"};
+}
+
+/**
+ * Calls a function with every record of a partition, in the order they were
+ * written, until it returns false.
+ */
+template <typename Func>
+void
+for_each_record (std::FILE *file, Func &&func)
+{
+  std::vector<unordered_record> records (4096);
+  std::rewind (file);
+  while (auto count = std::fread (records.data (), sizeof (unordered_record),
+                                  records.size (), file))
+    for (const auto &rec : records | std::views::take (count))
+      if (!func (rec))
+        return;
+  if (std::ferror (file))
+    throw std::system_error{errno, std::generic_category (), "fread"};
+}
+
+/**
+ * Compares the items of a partition in memory, adding their differences.
+ * If the table would not fit in the memory limit, as for a partition with
+ * most of the items, the partition is split again by the next bits of the
+ * hashes, as long as there are any.
+ *
+ * @param shift number of bits of the hashes the partition was split by
+ */
+inline void
+compare_partition (std::FILE *file, unsigned shift, std::size_t partitions,
+                   const char *first1, const char *first2,
+                   std::size_t memory_limit,
+                   unordered_differences &differences)
+{
+  auto bits = static_cast<unsigned> (std::countr_zero (partitions));
+  bool splittable = shift + bits <= 64;
+  unordered_table table{splittable ? memory_limit
+                                   : static_cast<std::size_t> (-1)};
+  bool fits = true;
+  for_each_record (file, [&] (const unordered_record &rec) {
+    return fits = table.add (rec.hash, static_cast<int> (rec.input));
+  });
+
+  if (!fits)
+    {
+      auto files = make_partitions (partitions);
+      for_each_record (file, [&] (const unordered_record &rec) {
+        auto index = (rec.hash.high >> shift) & (partitions - 1);
+        write_record (files[index].get (), rec);
+        return true;
+      });
+      for (auto &part : files)
+        {
+          compare_partition (part.get (), shift + bits, partitions, first1,
+                             first2, memory_limit, differences);
+          part.reset ();
+        }
+      return;
+    }
+
+  // The records of each input are in the order of the input.
+  if (table.unbalanced ())
+    for_each_record (file, [&] (const unordered_record &rec) {
+      auto count = table.count (rec.hash);
+      auto *first = rec.input == 0 ? first1 : first2;
+      unordered_occurrence at{first + rec.offset,
+                              first + rec.offset + rec.size,
+                              static_cast<std::size_t> (rec.line)};
+      if (rec.input == 0 && count > 0)
+        differences.add (differences.missing, at);
+      else if (rec.input == 1 && count < 0)
+        differences.add (differences.extra, at);
+      return true;
+    });
+}
+
+/**
+ * Compares the multisets of items of two inputs by partitioning them by
+ * their hashes into temporary files, and comparing every partition in
+ * memory.
+ *
+ * @param partitions number of partitions, a power of two
+ * @param memory_limit number of bytes of the table of a partition
+ */
+inline unordered_differences
+compare_partitioned (const char *first1, const char *last1,
+                     const char *first2, const char *last2,
+                     unordered_unit unit, std::size_t partitions,
+                     std::size_t memory_limit)
+{
+  auto files = make_partitions (partitions);
+  for (int input : {0, 1})
+    {
+      auto *first = input == 0 ? first1 : first2;
+      for_each_item (first, input == 0 ? last1 : last2, unit,
+                     [&] (const unordered_item &item) {
+                       const auto &at = item.occurrence;
+                       write_record (
+                           files[item.hash.high & (partitions - 1)].get (),
+                           {item.hash,
+                            static_cast<std::uint64_t> (at.first - first),
+                            static_cast<std::uint64_t> (at.last - at.first),
+                            at.line, static_cast<std::uint64_t> (input)});
+                       return true;
+                     });
+    }
+
+  unordered_differences differences;
+  auto bits = static_cast<unsigned> (std::countr_zero (partitions));
+  for (auto &file : files)
+    {
+      compare_partition (file.get (), bits, partitions, first1, first2,
+                         memory_limit, differences);
+      file.reset ();
+    }
+
+  return differences;
+}
+}
+
+/**
+ * Compares two contiguous inputs as multisets of lines or words, returning a
+ * mismatch or none if every item occurs as many times in both of them.
+ *
+ * The items are counted by their hashes in a table in linear time, and are
+ * equal if their 128-bit hashes are. If the table would grow beyond the
+ * memory limit, the items are instead partitioned by their hashes into
+ * temporary files, which are compared one at a time, and split again if they
+ * do not fit either.
+ *
+ * The mismatch has the earliest item of the first input which the second one
+ * has fewer of, and the earliest item of the second input which the first
+ * one has fewer of, either of which may be the end of its input if there is
+ * none. Its line number is that of the first item if there is one, or else
+ * that of the second one.
+ *
+ * @param first1 first input begin
+ * @param last1 first input end
+ * @param first2 last input begin
+ * @param last2 last input end
+ * @param unit items to compare
+ * @param memory_limit number of bytes of the table kept in memory
+ * @return mismatch or none
+ */
+inline std::optional<mismatch<const char *, const char *>>
+compare_unordered (const char *first1, const char *last1, const char *first2,
+                   const char *last2, unordered_unit unit,
+                   std::size_t memory_limit = default_unordered_memory_limit)
+{
+  detail::unordered_table table{memory_limit};
+  // The number of bytes scanned when the table stopped fitting.
+  std::size_t scanned = 0;
+  for (int input : {0, 1})
+    if (!detail::for_each_item (
+            input == 0 ? first1 : first2, input == 0 ? last1 : last2, unit,
+            [&] (const detail::unordered_item &item) {
+              if (table.add (item.hash, input))
+                return true;
+              auto *at = item.occurrence.first;
+              scanned = input == 0 ? at - first1
+                                   : (last1 - first1) + (at - first2);
+              return false;
+            }))
+      {
+        // Every partition should fit, judging by the items read so far.
+        std::size_t total = (last1 - first1) + (last2 - first2);
+        auto expected = static_cast<double> (table.size ()) * total
+                        / std::max (scanned, std::size_t{1});
+        auto partitions = std::bit_ceil (static_cast<std::size_t> (
+            std::clamp (expected * 4 * detail::unordered_table::slot_size ()
+                            / (static_cast<double> (memory_limit) + 1),
+                        2.0, 256.0)));
+        return detail::compare_partitioned (first1, last1, first2, last2,
+                                            unit, partitions, memory_limit)
+            .result (last1, last2);
+      }
+
+  // Inputs which differ are scanned again, for the earliest items which the
+  // other input has fewer of.
+  detail::unordered_differences differences;
+  if (table.unbalanced ())
+    for (int input : {0, 1})
+      detail::for_each_item (
+          input == 0 ? first1 : first2, input == 0 ? last1 : last2, unit,
+          [&] (const detail::unordered_item &item) {
+            auto count = table.count (item.hash);
+            if (input == 0 ? count <= 0 : count >= 0)
+              return true;
+            (input == 0 ? differences.missing : differences.extra)
+                = item.occurrence;
+            return false;
+          });
+  return differences.result (last1, last2);
+}
+}
+
+#endif /* __OICOMPARE_UNORDERED_HH__ */
\ No newline at end of file
@@ -0,0 +1,430 @@
+#ifndef __OICOMPARE_URING_HH__
+#define __OICOMPARE_URING_HH__
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <ranges>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <sys/types.h>
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#if defined(IORING_FEAT_RW_CUR_POS) && defined(__NR_io_uring_setup)
+#define OICOMPARE_HAVE_IO_URING 1
+#endif
+
+namespace oicompare
+{
+namespace detail
+{
+/**
+ * Reads a file at an offset into a buffer, retrying if interrupted. Returns
+ * the number of bytes read, zero at the end of the file.
+ */
+inline std::size_t
+pread_some (int fd, char *buffer, std::size_t size, std::uint64_t offset)
+{
+  while (true)
+    {
+      auto result = ::pread (fd, buffer, size, static_cast<off_t> (offset));
+      if (result >= 0)
+        return static_cast<std::size_t> (result);
+      else if (errno != EINTR)
+        throw std::system_error{errno, std::generic_category (), "pread"};
+    }
+}
+
+#ifdef OICOMPARE_HAVE_IO_URING
+/**
+ * A minimal io_uring instance, with a submission and a completion queue,
+ * queuing reads.
+ */
+class uring
+{
+public:
+  /**
+   * Sets up the queues, or returns none if io_uring is not available (or
+   * too old to read with IORING_OP_READ, which came along with
+   * IORING_FEAT_RW_CUR_POS).
+   *
+   * @param entries size of the submission queue
+   */
+  static std::unique_ptr<uring>
+  create (unsigned entries)
+  {
+    io_uring_params params;
+    std::memset (&params, 0, sizeof (params));
+    int fd = static_cast<int> (::syscall (__NR_io_uring_setup, entries,
+                                          &params));
+    if (fd < 0)
+      return nullptr;
+
+    std::unique_ptr<uring> ring{new uring{fd, params}};
+    if (!(params.features & IORING_FEAT_RW_CUR_POS) || !ring->map ())
+      return nullptr;
+    return ring;
+  }
+
+  uring (const uring &) = delete;
+  uring &operator= (const uring &) = delete;
+
+  ~uring ()
+  {
+    if (sqes_)
+      ::munmap (sqes_, params_.sq_entries * sizeof (io_uring_sqe));
+    if (cq_ring_ && cq_ring_ != sq_ring_)
+      ::munmap (cq_ring_, cq_ring_size_);
+    if (sq_ring_)
+      ::munmap (sq_ring_, sq_ring_size_);
+    ::close (fd_);
+  }
+
+  /**
+   * Queues a read, to be submitted by the next call of wait().
+   */
+  void
+  read (int fd, char *buffer, std::size_t size, std::uint64_t offset,
+        std::uint64_t user_data) noexcept
+  {
+    auto tail = *sq_tail_;
+    auto index = tail & *sq_mask_;
+    auto &sqe = sqes_[index];
+    std::memset (&sqe, 0, sizeof (sqe));
+    sqe.opcode = IORING_OP_READ;
+    sqe.fd = fd;
+    sqe.addr = reinterpret_cast<std::uintptr_t> (buffer);
+    sqe.len = static_cast<std::uint32_t> (size);
+    sqe.off = offset;
+    sqe.user_data = user_data;
+    sq_array_[index] = index;
+    std::atomic_ref{*sq_tail_}.store (tail + 1, std::memory_order_release);
+    ++queued_;
+  }
+
+  /**
+   * Submits the queued reads and waits for a completion, returning its user
+   * data and result (the number of bytes read or a negated error code).
+   */
+  std::pair<std::uint64_t, std::int32_t>
+  wait ()
+  {
+    while (true)
+      {
+        auto head = *cq_head_;
+        auto tail
+            = std::atomic_ref{*cq_tail_}.load (std::memory_order_acquire);
+        if (head != tail)
+          {
+            auto &cqe = cqes_[head & *cq_mask_];
+            std::pair<std::uint64_t, std::int32_t> result{cqe.user_data,
+                                                          cqe.res};
+            std::atomic_ref{*cq_head_}.store (head + 1,
+                                              std::memory_order_release);
+            return result;
+          }
+
+        auto result = ::syscall (__NR_io_uring_enter, fd_, queued_, 1,
+                                 IORING_ENTER_GETEVENTS, nullptr, 0);
+        if (result >= 0)
+          queued_ -= static_cast<unsigned> (result);
+        else if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+          throw std::system_error{errno, std::generic_category (),
+                                  "io_uring_enter"};
+      }
+  }
+
+private:
+  uring (int fd, const io_uring_params &params) noexcept
+      : fd_{fd}, params_{params}
+  {
+  }
+
+  bool
+  map () noexcept
+  {
+    sq_ring_size_
+        = params_.sq_off.array + params_.sq_entries * sizeof (unsigned);
+    cq_ring_size_ = params_.cq_off.cqes
+                    + params_.cq_entries * sizeof (io_uring_cqe);
+    bool single = params_.features & IORING_FEAT_SINGLE_MMAP;
+    if (single)
+      sq_ring_size_ = cq_ring_size_ = std::max (sq_ring_size_, cq_ring_size_);
+
+    auto map_ring = [this] (std::size_t size, off_t offset) -> char * {
+      auto *address = ::mmap (nullptr, size, PROT_READ | PROT_WRITE,
+                              MAP_SHARED | MAP_POPULATE, fd_, offset);
+      return address == MAP_FAILED ? nullptr : static_cast<char *> (address);
+    };
+
+    sq_ring_ = map_ring (sq_ring_size_, IORING_OFF_SQ_RING);
+    if (!sq_ring_)
+      return false;
+    cq_ring_
+        = single ? sq_ring_ : map_ring (cq_ring_size_, IORING_OFF_CQ_RING);
+    if (!cq_ring_)
+      return false;
+    auto *sqes = ::mmap (nullptr, params_.sq_entries * sizeof (io_uring_sqe),
+                         PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+      return false;
+    sqes_ = static_cast<io_uring_sqe *> (sqes);
+
+    auto field = [] (char *ring, std::uint32_t offset) {
+      return reinterpret_cast<unsigned *> (ring + offset);
+    };
+    sq_tail_ = field (sq_ring_, params_.sq_off.tail);
+    sq_mask_ = field (sq_ring_, params_.sq_off.ring_mask);
+    sq_array_ = field (sq_ring_, params_.sq_off.array);
+    cq_head_ = field (cq_ring_, params_.cq_off.head);
+    cq_tail_ = field (cq_ring_, params_.cq_off.tail);
+    cq_mask_ = field (cq_ring_, params_.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe *> (cq_ring_ + params_.cq_off.cqes);
+    return true;
+  }
+
+  int fd_;
+  io_uring_params params_;
+  std::size_t sq_ring_size_ = 0;
+  std::size_t cq_ring_size_ = 0;
+  char *sq_ring_ = nullptr;
+  char *cq_ring_ = nullptr;
+  io_uring_sqe *sqes_ = nullptr;
+  unsigned *sq_tail_ = nullptr;
+  unsigned *sq_mask_ = nullptr;
+  unsigned *sq_array_ = nullptr;
+  unsigned *cq_head_ = nullptr;
+  unsigned *cq_tail_ = nullptr;
+  unsigned *cq_mask_ = nullptr;
+  io_uring_cqe *cqes_ = nullptr;
+  unsigned queued_ = 0;
+};
+#endif
+}
+
+/**
+ * Default size of a chunk read by a uring_source.
+ */
+constexpr std::size_t default_uring_chunk_size = std::size_t{1} << 18;
+
+/**
+ * Default number of chunks of a uring_source read at the same time.
+ */
+constexpr std::size_t default_uring_depth = 4;
+
+/**
+ * A stream source reading a regular file in chunks, with reads of the next
+ * chunks in flight on io_uring while the current one is compared, so that a
+ * file which is not in the page cache is read while it is compared.
+ *
+ * Where io_uring is not available, chunks are read with pread() as they are
+ * needed.
+ */
+class uring_source
+{
+public:
+  /**
+   * Reads a file open for reading, which stays owned by the caller, from
+   * its beginning.
+   *
+   * @param fd file descriptor
+   * @param size size of the file, the reads stop at it or at the end of the
+   *             file if it is earlier
+   * @param chunk_size size of a chunk
+   * @param depth number of chunks read at the same time
+   */
+  uring_source (int fd, std::uint64_t size,
+                std::size_t chunk_size = default_uring_chunk_size,
+                std::size_t depth = default_uring_depth)
+      : fd_{fd}, size_{size}, chunk_size_{std::max (chunk_size,
+                                                    std::size_t{1})}
+  {
+#ifdef OICOMPARE_HAVE_IO_URING
+    depth = std::max (depth, std::size_t{1});
+    ring_ = detail::uring::create (static_cast<unsigned> (depth));
+    if (!ring_)
+      return;
+
+    buffer_.reset (new char[depth * chunk_size_]);
+    chunks_.resize (depth);
+    for (std::size_t i = 0; i < depth; ++i)
+      {
+        chunks_[i].data = buffer_.get () + i * chunk_size_;
+        start (i);
+      }
+#else
+    static_cast<void> (depth);
+#endif
+  }
+
+  uring_source (uring_source &&) noexcept = default;
+  uring_source &operator= (uring_source &&) noexcept = default;
+
+  ~uring_source ()
+  {
+#ifdef OICOMPARE_HAVE_IO_URING
+    // The kernel must not write into the buffers once they are freed.
+    if (ring_)
+      try
+        {
+          for (auto pending = std::ranges::count_if (
+                   chunks_, [] (const chunk &chunk) { return chunk.pending; });
+               pending > 0; --pending)
+            ring_->wait ();
+        }
+      catch (const std::system_error &)
+        {
+        }
+#endif
+  }
+
+  /**
+   * Whether the reads are overlapped on io_uring, rather than done with
+   * pread().
+   */
+  bool
+  overlapped () const noexcept
+  {
+#ifdef OICOMPARE_HAVE_IO_URING
+    return ring_ != nullptr;
+#else
+    return false;
+#endif
+  }
+
+  std::size_t
+  read (char *buffer, std::size_t size)
+  {
+#ifdef OICOMPARE_HAVE_IO_URING
+    if (ring_)
+      return read_chunks (buffer, size);
+#endif
+
+    if (offset_ >= size_)
+      return 0;
+    auto count = detail::pread_some (
+        fd_, buffer, static_cast<std::size_t> (std::min<std::uint64_t> (
+                         size, size_ - offset_)),
+        offset_);
+    offset_ = count > 0 ? offset_ + count : size_;
+    return count;
+  }
+
+private:
+#ifdef OICOMPARE_HAVE_IO_URING
+  /**
+   * A chunk of the file, being read or read.
+   */
+  struct chunk
+  {
+    char *data = nullptr;
+    std::uint64_t offset = 0;
+    std::size_t size = 0;
+    std::size_t filled = 0;
+    std::size_t consumed = 0;
+    bool pending = false;
+  };
+
+  /**
+   * Starts reading the next chunk of the file into a chunk buffer, or marks
+   * it empty past the end of the file.
+   */
+  void
+  start (std::size_t index) noexcept
+  {
+    auto &chunk = chunks_[index];
+    chunk.offset = offset_;
+    chunk.size = static_cast<std::size_t> (
+        std::min<std::uint64_t> (chunk_size_, size_ - std::min (offset_,
+                                                                size_)));
+    chunk.filled = chunk.consumed = 0;
+    chunk.pending = chunk.size > 0;
+    offset_ += chunk.size;
+    if (chunk.pending)
+      ring_->read (fd_, chunk.data, chunk.size, chunk.offset, index);
+  }
+
+  /**
+   * Waits until a chunk is read, handling the other completions meanwhile.
+   */
+  void
+  complete (std::size_t index)
+  {
+    while (chunks_[index].pending)
+      {
+        auto [other, result] = ring_->wait ();
+        auto &chunk = chunks_[other];
+        if (result == -EINTR || result == -EAGAIN)
+          ;
+        else if (result < 0)
+          throw std::system_error{-result, std::generic_category (),
+                                  "io_uring read"};
+        else if (result == 0)
+          {
+            // The file is shorter than its size was.
+            chunk.size = chunk.filled;
+            chunk.pending = false;
+            continue;
+          }
+        else
+          chunk.filled += static_cast<std::size_t> (result);
+
+        if (chunk.filled < chunk.size)
+          ring_->read (fd_, chunk.data + chunk.filled,
+                       chunk.size - chunk.filled,
+                       chunk.offset + chunk.filled, other);
+        else
+          chunk.pending = false;
+      }
+  }
+
+  std::size_t
+  read_chunks (char *buffer, std::size_t size)
+  {
+    while (true)
+      {
+        auto index = current_ % chunks_.size ();
+        complete (index);
+
+        auto &chunk = chunks_[index];
+        if (auto count = std::min (size, chunk.filled - chunk.consumed))
+          {
+            std::memcpy (buffer, chunk.data + chunk.consumed, count);
+            chunk.consumed += count;
+            return count;
+          }
+        else if (chunk.size < chunk_size_)
+          return 0;
+
+        start (index);
+        ++current_;
+      }
+  }
+
+  std::unique_ptr<detail::uring> ring_;
+  std::unique_ptr<char[]> buffer_;
+  std::vector<chunk> chunks_;
+  std::size_t current_ = 0;
+#endif
+
+  int fd_;
+  std::uint64_t size_;
+  std::size_t chunk_size_;
+  std::uint64_t offset_ = 0;
+};
+}
+
+#endif /* __OICOMPARE_URING_HH__ */
\ No newline at end of file
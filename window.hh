@@ -0,0 +1,147 @@
+#ifndef __OICOMPARE_WINDOW_HH__
+#define __OICOMPARE_WINDOW_HH__
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace oicompare
+{
+/**
+ * Default size of the window of a window_source.
+ */
+constexpr std::size_t default_window_size = std::size_t{1} << 24;
+
+/**
+ * A stream source mapping a fixed-size window of a regular file at a time,
+ * which the stream_reader reads in place of a buffer. As the file is read, the
+ * window is unmapped and mapped again from the beginning of the current token,
+ * so the address space and the resident memory taken stay the same for any
+ * size of the file, as under a limit of the address space (RLIMIT_AS), and a
+ * token is only truncated if it is longer than the window.
+ */
+class window_source
+{
+public:
+  /**
+   * Reads a file open for reading, which stays owned by the caller, from
+   * its beginning.
+   *
+   * @param fd file descriptor
+   * @param size size of the file
+   * @param window_size size of the window, rounded up to whole pages
+   */
+  window_source (int fd, std::uint64_t size,
+                 std::size_t window_size = default_window_size)
+      : fd_{fd}, size_{size},
+        page_size_{static_cast<std::size_t> (::sysconf (_SC_PAGESIZE))}
+  {
+    window_size_ = std::max (
+        (window_size + page_size_ - 1) / page_size_ * page_size_, page_size_);
+  }
+
+  window_source (window_source &&other) noexcept
+      : fd_{other.fd_}, size_{other.size_}, page_size_{other.page_size_},
+        window_size_{other.window_size_},
+        mapping_{std::exchange (other.mapping_, nullptr)},
+        mapping_length_{other.mapping_length_}
+  {
+  }
+
+  window_source &
+  operator= (window_source &&other) noexcept
+  {
+    std::swap (fd_, other.fd_);
+    std::swap (size_, other.size_);
+    std::swap (page_size_, other.page_size_);
+    std::swap (window_size_, other.window_size_);
+    std::swap (mapping_, other.mapping_);
+    std::swap (mapping_length_, other.mapping_length_);
+    return *this;
+  }
+
+  ~window_source () { unmap (); }
+
+  /**
+   * Size of the file.
+   */
+  std::uint64_t
+  size () const noexcept
+  {
+    return size_;
+  }
+
+  /**
+   * Size of the window, which is the longest part of the file map() returns.
+   */
+  std::size_t
+  window_size () const noexcept
+  {
+    return window_size_;
+  }
+
+  /**
+   * Maps the window beginning at an offset, in place of the previous one.
+   *
+   * @param offset offset in the file
+   * @return the part of the file in the window, which is window_size() bytes
+   * unless the file ends first
+   */
+  std::string_view
+  map (std::uint64_t offset)
+  {
+    unmap ();
+    if (offset >= size_)
+      return {};
+
+    // The mapping begins at a page, a little before the window.
+    auto aligned = offset / page_size_ * page_size_;
+    auto end = std::min<std::uint64_t> (offset + window_size_, size_);
+    auto length = static_cast<std::size_t> (end - aligned);
+    // The window is read whole right away, so its pages are mapped up front
+    // rather than faulted in one by one, or at least read ahead.
+    int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    flags |= MAP_POPULATE;
+#endif
+    auto *address = ::mmap (nullptr, length, PROT_READ, flags, fd_,
+                            static_cast<off_t> (aligned));
+    if (address == MAP_FAILED)
+      throw std::system_error{errno, std::generic_category (), "mmap"};
+
+    mapping_ = static_cast<char *> (address);
+    mapping_length_ = length;
+#ifndef MAP_POPULATE
+    ::madvise (address, length, MADV_SEQUENTIAL);
+    ::madvise (address, length, MADV_WILLNEED);
+#endif
+    return {mapping_ + (offset - aligned),
+            static_cast<std::size_t> (end - offset)};
+  }
+
+private:
+  void
+  unmap () noexcept
+  {
+    if (mapping_)
+      ::munmap (mapping_, mapping_length_);
+    mapping_ = nullptr;
+  }
+
+  int fd_;
+  std::uint64_t size_;
+  std::size_t page_size_;
+  std::size_t window_size_;
+  char *mapping_ = nullptr;
+  std::size_t mapping_length_ = 0;
+};
+}
+
+#endif /* __OICOMPARE_WINDOW_HH__ */
\ No newline at end of file
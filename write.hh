@@ -0,0 +1,34 @@
+#ifndef __OICOMPARE_WRITE_HH__
+#define __OICOMPARE_WRITE_HH__
+
+#include <cerrno>
+#include <cstddef>
+#include <string_view>
+#include <system_error>
+
+#include <unistd.h>
+
+namespace oicompare::io
+{
+/**
+ * Writes data to a file descriptor, with a single write() unless it is cut
+ * short.
+ *
+ * @param fd file descriptor
+ * @param data data to write
+ */
+inline void
+write_all (int fd, std::string_view data)
+{
+  while (!data.empty ())
+    {
+      auto result = ::write (fd, data.data (), data.size ());
+      if (result < 0 && errno != EINTR)
+        throw std::system_error{errno, std::generic_category (), "write"};
+      else if (result > 0)
+        data.remove_prefix (static_cast<std::size_t> (result));
+    }
+}
+}
+
+#endif /* __OICOMPARE_WRITE_HH__ */
\ No newline at end of file